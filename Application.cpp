@@ -4,14 +4,179 @@
 #include "classes/Checkers.h"
 #include "classes/Othello.h"
 #include "classes/Connect4.h"
+#include "classes/SpriteStore.h"
+#include "classes/ResourcePack.h"
+#include "classes/PerfStats.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <vector>
 
 namespace ClassGame {
         //
         // our global variables
         //
         Game *game = nullptr;
-        bool gameOver = false;
-        int gameWinner = -1;
+        bool analysisMode = false;
+        bool showPerformance = false;
+        // microseconds of AI search per frame when it can't have a thread, 0 searches on the pool
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+        int aiFrameBudget = 8000;
+#else
+        int aiFrameBudget = 0;
+#endif
+        std::atomic<void (*)()> wakeUp(nullptr);
+
+        void SetWakeUp(void (*handler)())
+        {
+                wakeUp = handler;
+        }
+
+        void WakeUp()
+        {
+                void (*handler)() = wakeUp;
+                if (handler) {
+                    handler();
+                }
+        }
+
+        double IdleWaitTime()
+        {
+                if (SpriteStore::local().activeTweens() > 0) {
+                    return 0.0;
+                }
+                if (game && !game->isGameOver() && game->gameHasAI() && (game->getCurrentPlayer()->isAIPlayer() || game->_gameOptions.AIvsAI)) {
+                    return 0.0;
+                }
+                // analysis wakes us when a depth finishes, this just keeps the node rate ticking
+                if (game && analysisMode && aiFrameBudget == 0) {
+                    return 0.5;
+                }
+                return 2.0;
+        }
+
+        //
+        // live scores for every legal move from the background analyser
+        //
+        static void RenderAnalysis()
+        {
+                Analyzer *analyzer = game->analyzer();
+                if (!analyzer) {
+                    return;
+                }
+                // the analyser searches on a thread of its own, which a build without threads can't start
+                if (aiFrameBudget > 0) {
+                    analyzer->stop();
+                    ImGui::TextDisabled("Analysis needs threads");
+                    return;
+                }
+                ImGui::Checkbox("Analysis", &analysisMode);
+                analyzer->setUpdateCallback(WakeUp);
+                if (!analysisMode || game->isGameOver()) {
+                    analyzer->stop();
+                    return;
+                }
+                // cheap when the position hasn't changed since the last frame
+                analyzer->analyze(game->searchState());
+
+                ImGui::Text("Depth %d%s, %.0fk nodes/s", analyzer->depth(), analyzer->solved() ? " (solved)" : "", analyzer->nodesPerSecond() / 1000.0);
+                std::vector<Analyzer::MoveScore> scores;
+                analyzer->scores(scores);
+                for (const Analyzer::MoveScore &move : scores) {
+                    int plies = Analyzer::WinScore - std::abs(move.score);
+                    if (plies < 1000) {
+                        ImGui::Text("%-12s %s in %d", move.name.c_str(), move.score > 0 ? "win" : "loss", (plies + 1) / 2);
+                    } else {
+                        ImGui::Text("%-12s %+d", move.name.c_str(), move.score);
+                    }
+                }
+        }
+
+        //
+        // where the frame time goes: the frame time history, the time in each
+        // instrumented section, heap allocations and texture memory
+        //
+        static void RenderPerformance()
+        {
+                if (!showPerformance) {
+                    return;
+                }
+                std::vector<PerfStats::Frame> frames;
+                PerfStats::history(frames);
+                if (frames.empty()) {
+                    return;
+                }
+                ImGui::SetNextWindowBgAlpha(0.85f);
+                if (!ImGui::Begin("Performance", &showPerformance, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing)) {
+                    ImGui::End();
+                    return;
+                }
+
+                // waiting for input isn't work, so the graph leaves it out
+                std::vector<float> busy;
+                float total = 0.0f;
+                float worst = 0.0f;
+                int worstAllocations = 0;
+                PerfStats::Frame worstSections = {};
+                for (const PerfStats::Frame &frame : frames) {
+                    float milliseconds = frame.milliseconds - frame.sections[PerfStats::Idle];
+                    busy.push_back(milliseconds);
+                    total += milliseconds;
+                    worst = std::max(worst, milliseconds);
+                    worstAllocations = std::max(worstAllocations, frame.allocations);
+                    for (int i = 0; i < PerfStats::SectionCount; i++) {
+                        worstSections.sections[i] = std::max(worstSections.sections[i], frame.sections[i]);
+                    }
+                }
+                const PerfStats::Frame &last = frames.back();
+                char overlay[64];
+                snprintf(overlay, sizeof(overlay), "%.2f ms avg, %.2f ms worst", total / busy.size(), worst);
+                ImGui::PlotLines("##frames", busy.data(), (int)busy.size(), 0, overlay, 0.0f, 33.3f, ImVec2(320, 70));
+
+                if (ImGui::BeginTable("sections", 3, ImGuiTableFlags_SizingFixedFit)) {
+                    ImGui::TableSetupColumn("section");
+                    ImGui::TableSetupColumn("last ms");
+                    ImGui::TableSetupColumn("worst ms");
+                    ImGui::TableHeadersRow();
+                    for (int i = 0; i < PerfStats::SectionCount; i++) {
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(PerfStats::sectionName((PerfStats::Section)i));
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", last.sections[i]);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", worstSections.sections[i]);
+                    }
+                    ImGui::EndTable();
+                }
+                ImGui::Text("Allocations %d last frame, %d worst (all threads)", last.allocations, worstAllocations);
+                ImGui::Text("Texture memory %.2f MB", PerfStats::textureBytes() / (1024.0 * 1024.0));
+                ImGui::End();
+        }
+
+        //
+        // takeback buttons. against the AI a step goes back to (or forward to) the
+        // human's turn, otherwise the AI would just play its move again
+        //
+        static void RenderUndoRedo()
+        {
+                bool againstAI = game->gameHasAI() && !game->_gameOptions.AIvsAI;
+                ImGui::BeginDisabled(!game->canUndo());
+                if (ImGui::Button("Undo")) {
+                    game->undoMove();
+                    while (againstAI && game->getCurrentPlayer()->isAIPlayer() && game->undoMove()) {
+                    }
+                }
+                ImGui::EndDisabled();
+                ImGui::SameLine();
+                ImGui::BeginDisabled(!game->canRedo());
+                if (ImGui::Button("Redo")) {
+                    game->redoMove();
+                    while (againstAI && game->getCurrentPlayer()->isAIPlayer() && !game->isGameOver() && game->redoMove()) {
+                    }
+                }
+                ImGui::EndDisabled();
+        }
 
         //
         // game starting point
@@ -20,6 +185,22 @@ namespace ClassGame {
         void GameStartUp() 
         {
             game = nullptr;
+            // map the pre-decoded images now, not when the first piece is made
+            ResourcePack::instance();
+        }
+
+        //
+        // called by the main loop on the way out, while the graphics are still up
+        // a ponder search only stops when told to, and left running it would keep
+        // the pool's workers busy and hang the pool's destructor at exit
+        //
+        void GameShutDown()
+        {
+            if (game) {
+                game->stopPondering();
+                delete game;
+                game = nullptr;
+            }
         }
 
         //
@@ -28,20 +209,21 @@ namespace ClassGame {
         //
         void RenderGame() 
         {
+                PerfStats::beginFrame();
                 ImGui::DockSpaceOverViewport();
 
                 //ImGui::ShowDemoWindow();
 
                 ImGui::Begin("Settings");
+                ImGui::Checkbox("Performance", &showPerformance);
 
-                if (gameOver) {
+                if (game && game->isGameOver()) {
                     ImGui::Text("Game Over!");
-                    ImGui::Text("Winner: %d", gameWinner);
+                    ImGui::Text("Winner: %d", game->gameWinner());
                     if (ImGui::Button("Reset Game")) {
+                        game->stopPondering();
                         game->stopGame();
                         game->setUpBoard();
-                        gameOver = false;
-                        gameWinner = -1;
                     }
                 }
                 if (!game) {
@@ -70,35 +252,28 @@ namespace ClassGame {
                 } else {
                     ImGui::Text("Current Player Number: %d", game->getCurrentPlayer()->playerNumber());
                     ImGui::Text("Current Board State: %s", game->stateString().c_str());
+                    RenderUndoRedo();
+                    ImGui::SliderInt("AI us/frame", &aiFrameBudget, 0, 16000, aiFrameBudget > 0 ? "%d" : "threaded");
+                    RenderAnalysis();
                 }
                 ImGui::End();
 
                 ImGui::Begin("GameWindow");
                 if (game) {
+                    game->_gameOptions.AIFrameBudget = aiFrameBudget;
                     if (game->gameHasAI() && (game->getCurrentPlayer()->isAIPlayer() || game->_gameOptions.AIvsAI))
                     {
+                        PerfStats::Scope timing(PerfStats::UpdateAI);
                         game->updateAI();
                     }
+                    else if (game->gameHasAI() && !game->isGameOver())
+                    {
+                        game->ponder();
+                    }
+                    PerfStats::Scope timing(PerfStats::DrawFrame);
                     game->drawFrame();
                 }
                 ImGui::End();
-        }
-
-        //
-        // end turn is called by the game code at the end of each turn
-        // this is where we check for a winner
-        //
-        void EndOfTurn() 
-        {
-            Player *winner = game->checkForWinner();
-            if (winner)
-            {
-                gameOver = true;
-                gameWinner = winner->playerNumber();
-            }
-            if (game->checkForDraw()) {
-                gameOver = true;
-                gameWinner = -1;
-            }
+                RenderPerformance();
         }
 }
@@ -3,5 +3,14 @@
 namespace ClassGame {
     void GameStartUp();
     void RenderGame();
-    void EndOfTurn();
+    // stop the game's background searches and free it, before the main loop tears down
+    void GameShutDown();
+
+    // how long the main loop may block waiting for input before the next frame,
+    // 0 while something needs frames back to back (pieces moving, the AI to move)
+    double IdleWaitTime();
+    // the main loop's way of waking itself from another thread, and a call to it
+    // that is safe from anywhere (e.g. when background analysis has new scores)
+    void SetWakeUp(void (*wakeUp)());
+    void WakeUp();
 }
@@ -0,0 +1,220 @@
+#include "Analyzer.h"
+
+#include <algorithm>
+#include <functional>
+
+static const int kTableSize = 1 << 18;
+static const int kMaxDepth = 64;
+static const int kInfinity = Analyzer::WinScore + 1000;
+// scores this close to WinScore are forced wins or losses, plies away
+static const int kMateScore = Analyzer::WinScore - 1000;
+
+//
+// the table keeps a forced result as the distance from the stored node, not from
+// the root, so it reads back right at another ply or from a later root
+//
+static int scoreToTable(int score, int ply)
+{
+    if (score > kMateScore && score <= Analyzer::WinScore) return score + ply;
+    if (score < -kMateScore && score >= -Analyzer::WinScore) return score - ply;
+    return score;
+}
+
+static int scoreFromTable(int score, int ply)
+{
+    if (score > kMateScore && score <= Analyzer::WinScore) return score - ply;
+    if (score < -kMateScore && score >= -Analyzer::WinScore) return score + ply;
+    return score;
+}
+
+Analyzer::Analyzer(const MCTSRules &rules) : _rules(rules), _generation(0), _nodes(0), _depth(0), _solved(false), _aborted(false), _horizon(false)
+{
+}
+
+Analyzer::~Analyzer()
+{
+    stop();
+}
+
+void Analyzer::analyze(const std::string &state)
+{
+    if (_thread.joinable() && state == _state) {
+        return;
+    }
+    stop();
+
+    _state = state;
+    _nodes = 0;
+    _depth = 0;
+    _solved = false;
+    _started = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _scores.clear();
+    }
+    if (_table.empty()) {
+        _table.resize(kTableSize);
+    }
+    int generation = _generation;
+    _thread = std::thread(&Analyzer::run, this, state, generation);
+}
+
+void Analyzer::stop()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+    // the search notices the new generation within a few hundred nodes
+    _generation++;
+    _thread.join();
+}
+
+void Analyzer::scores(std::vector<MoveScore> &scores) const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    scores = _scores;
+}
+
+void Analyzer::setUpdateCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _updateCallback = std::move(callback);
+}
+
+double Analyzer::nodesPerSecond() const
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _started).count();
+    return seconds > 0.0 ? _nodes / seconds : 0.0;
+}
+
+void Analyzer::run(std::string state, int generation)
+{
+    std::vector<int> moves;
+    _rules.generateMoves(state, moves);
+    if (moves.empty() || _rules.result(state) != MCTSRules::Ongoing) {
+        _solved = true;
+        return;
+    }
+
+    std::vector<MoveScore> ranked;
+    for (int move : moves) {
+        ranked.push_back({move, 0, _rules.moveName(move)});
+    }
+
+    for (int depth = 1; depth <= kMaxDepth; depth++) {
+        _aborted = false;
+        _horizon = false;
+        for (MoveScore &entry : ranked) {
+            std::string child = state;
+            _rules.playMove(child, entry.move);
+            entry.score = childScore(state, child, depth - 1, 1, -kInfinity, kInfinity, generation);
+            if (_aborted) {
+                return;
+            }
+        }
+
+        // the next iteration searches the best moves first
+        std::stable_sort(ranked.begin(), ranked.end(), [](const MoveScore &a, const MoveScore &b) { return a.score > b.score; });
+        std::function<void()> updated;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _scores = ranked;
+            updated = _updateCallback;
+        }
+        _depth = depth;
+        if (updated) {
+            updated();
+        }
+
+        // nothing was cut off by the depth limit, so the scores are exact
+        if (!_horizon) {
+            _solved = true;
+            return;
+        }
+    }
+}
+
+//
+// search a child and return its score for the parent's player to move
+// (the same player keeps the move after an Othello pass or a checkers multi-jump)
+//
+int Analyzer::childScore(const std::string &parent, std::string &child, int depth, int ply, int alpha, int beta, int generation)
+{
+    if (_rules.currentPlayer(child) == _rules.currentPlayer(parent)) {
+        return search(child, depth, ply, alpha, beta, generation);
+    }
+    return -search(child, depth, ply, -beta, -alpha, generation);
+}
+
+int Analyzer::search(std::string &state, int depth, int ply, int alpha, int beta, int generation)
+{
+    if ((++_nodes & 255) == 0 && _generation != generation) {
+        _aborted = true;
+    }
+    if (_aborted) {
+        return 0;
+    }
+
+    int result = _rules.result(state);
+    if (result != MCTSRules::Ongoing) {
+        if (result == MCTSRules::Draw) {
+            return 0;
+        }
+        return result == _rules.currentPlayer(state) ? WinScore - ply : -(WinScore - ply);
+    }
+    if (depth <= 0) {
+        _horizon = true;
+        return _rules.evaluate(state);
+    }
+
+    uint64_t key = std::hash<std::string>()(state);
+    Entry &entry = _table[key % _table.size()];
+    int bestMove = -1;
+    if (entry.key == key && entry.bound != BoundNone) {
+        if (entry.depth >= depth) {
+            int score = scoreFromTable(entry.score, ply);
+            bool usable = entry.bound == BoundExact || (entry.bound == BoundLower && score >= beta) || (entry.bound == BoundUpper && score <= alpha);
+            if (usable) {
+                // a cached heuristic is still a heuristic, the position isn't solved by it
+                _horizon |= entry.horizon;
+                return score;
+            }
+        }
+    }
+
+    // track whether this subtree hit the depth limit, for its table entry
+    bool outerHorizon = _horizon;
+    _horizon = false;
+    int originalAlpha = alpha;
+    int best = -kInfinity;
+    std::vector<int> moves;
+    _rules.generateMoves(state, moves);
+    for (int move : moves) {
+        std::string child = state;
+        _rules.playMove(child, move);
+        int score = childScore(state, child, depth - 1, ply + 1, alpha, beta, generation);
+        if (_aborted) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+            bestMove = move;
+        }
+        if (best > alpha) {
+            alpha = best;
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    if (bestMove >= 0 || moves.empty()) {
+        entry.key = key;
+        entry.score = scoreToTable(best, ply);
+        entry.depth = (int16_t)depth;
+        entry.bound = best <= originalAlpha ? BoundUpper : (best >= beta ? BoundLower : BoundExact);
+        entry.horizon = _horizon;
+    }
+    _horizon |= outerHorizon;
+    return best;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MCTS.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// background analysis of a position for the Settings window
+// an iterative deepening negamax over a game's search rules that scores every
+// legal move at each depth (full multi-PV). it runs on its own thread rather than
+// the pool, since a task that never finishes would stall any pool thread that
+// picked it up while waiting on something else.
+// the transposition table survives restarts, so following a game is cheap.
+//
+class Analyzer
+{
+public:
+    static const int WinScore = 1000000;
+
+    struct MoveScore {
+        int move;
+        int score;              // for the player to move, WinScore - plies for a forced win
+        std::string name;
+    };
+
+    explicit Analyzer(const MCTSRules &rules);
+    ~Analyzer();
+
+    // analyse this position; cheap to call every frame with the same one,
+    // and a different position cancels the old search and starts over
+    void analyze(const std::string &state);
+    void stop();
+    bool running() const { return _thread.joinable(); }
+    // called on the analysis thread whenever a deeper iteration has finished
+    void setUpdateCallback(std::function<void()> callback);
+
+    // results of the deepest finished iteration, best move first
+    void scores(std::vector<MoveScore> &scores) const;
+    int depth() const { return _depth; }
+    bool solved() const { return _solved; }
+    long long nodes() const { return _nodes; }
+    double nodesPerSecond() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        int score;
+        int16_t depth;
+        uint8_t bound;
+        bool horizon;           // the score rests on a depth limited evaluate()
+    };
+    enum Bound { BoundNone, BoundExact, BoundLower, BoundUpper };
+
+    void run(std::string state, int generation);
+    int search(std::string &state, int depth, int ply, int alpha, int beta, int generation);
+    int childScore(const std::string &parent, std::string &child, int depth, int ply, int alpha, int beta, int generation);
+
+    const MCTSRules &_rules;
+    std::vector<Entry> _table;
+    std::thread _thread;
+    std::string _state;
+    std::atomic<int> _generation;
+    std::atomic<long long> _nodes;
+    std::atomic<int> _depth;
+    std::atomic<bool> _solved;
+    bool _aborted;
+    bool _horizon;
+    std::chrono::steady_clock::time_point _started;
+    mutable std::mutex _lock;
+    std::vector<MoveScore> _scores;
+    std::function<void()> _updateCallback;
+};
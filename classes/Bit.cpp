@@ -22,7 +22,7 @@ BitHolder *Bit::getHolder()
 
 void Bit::setPickedUp(bool up)
 {
-	if (up != _pickedUp)
+	if (up != getPickedUp())
 	{
 		float opacity = 0.0f;
 		float scale = 1.0f;
@@ -52,7 +52,7 @@ void Bit::setPickedUp(bool up)
 		setLocalZOrder(z);
 		setOpacity(opacity);
 		setRotation(rotation);
-		_pickedUp = up;
+		setFlag(SpriteStore::PickedUp, up);
 	}
 }
 
@@ -68,7 +68,7 @@ bool Bit::unfriendly()
 
 bool Bit::getPickedUp()
 {
-	return _pickedUp;
+	return hasFlag(SpriteStore::PickedUp);
 }
 
 Player *Bit::getOwner()
@@ -76,31 +76,28 @@ Player *Bit::getOwner()
 	return _owner;
 }
 
-void Bit::moveTo(const ImVec2 &point)
+void Bit::moveTo(const ImVec2 &point, SpriteStore::Done done)
 {
-	_destinationPosition = point;
-	// work out the step so we move same step each update
-	ImVec2 delta = ImVec2(_destinationPosition.x - getPosition().x, _destinationPosition.y - getPosition().y);
-	_destinationStep = ImVec2(delta.x * 0.05f, delta.y * 0.05f);
-	_moving = true;
+	_store->startMove(_handle, point, kMoveSeconds, std::move(done));
 }
 
-void Bit::update()
+void Bit::flipTo(ImTextureID texture, bool animate, SpriteStore::Done done)
 {
-	if (!_moving)
+	if (!animate)
 	{
+		// a flip already running ends first, then we show the new face
+		_store->finish(_handle);
+		setTexture(texture, getSize());
+		if (done)
+		{
+			done();
+		}
 		return;
 	}
-	ImVec2 pos = getPosition();
-	ImVec2 delta = ImVec2(_destinationPosition.x - pos.x, _destinationPosition.y - pos.y);
-	if (std::fabs(delta.x) >= 0.1f || std::fabs(delta.y) > 0.1f)
-	{
-		ImVec2 newPosition = ImVec2(pos.x + _destinationStep.x, pos.y + _destinationStep.y);
-		setPosition(newPosition);
-	}
-	else
-	{
-		setPosition(_destinationPosition);
-		_moving = false;
-	}
-}
\ No newline at end of file
+	_store->startFlip(_handle, texture, kFlipSeconds, std::move(done));
+}
+
+void Bit::update()
+{
+	_store->advance();
+}
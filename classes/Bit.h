@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Sprite.h"
+#include "Pooled.h"
 
 class Player;
 class BitHolder;
@@ -10,6 +11,9 @@ class BitHolder;
 //
 #define kPickedUpScale 1.2f
 #define kPickedUpOpacity 255
+// how long the animations take, in seconds
+#define kMoveSeconds 0.33f
+#define kFlipSeconds 0.17f
 
 enum bitz
 {
@@ -19,16 +23,15 @@ enum bitz
 	kMovingZ = 9930
 };
 
-class Bit : public Sprite
+class Bit : public Sprite, public Pooled<Bit>
 {
 public:
 	Bit() : Sprite()
 	{
-		_pickedUp = false;
 		_owner = nullptr;
 		_gameTag = 0;
 		_entityType = EntityBit;
-		_moving = false;
+		setFlag(SpriteStore::Piece, true);
 	};
 
 	~Bit();
@@ -48,19 +51,20 @@ public:
 	// game defined game tags
 	const int gameTag() const { return _gameTag; };
 	void setGameTag(int tag) { _gameTag = tag; };
-	// move to a position
-	void moveTo(const ImVec2 &point);
+	// slide to a position, done (if any) is called once the bit gets there
+	void moveTo(const ImVec2 &point, SpriteStore::Done done = nullptr);
+	// bring this bit's animations (and any others running) up to now
 	void update();
 	void setOpacity(float opacity){};
-	bool getMoving() { return _moving; };
+	bool getMoving() { return hasFlag(SpriteStore::Moving); };
+	// turn over in place to show another texture (an Othello disc changing color)
+	// animated, the bit squeezes to its edge and opens again over the next updates
+	void flipTo(ImTextureID texture, bool animate, SpriteStore::Done done = nullptr);
+	bool getFlipping() { return hasFlag(SpriteStore::Flipping); };
 
 private:
 	int _restingZ;
 	float _restingTransform;
-	bool _pickedUp;
 	Player *_owner;
 	int _gameTag;
-	ImVec2 _destinationPosition;
-	ImVec2 _destinationStep;
-	bool _moving;
 };
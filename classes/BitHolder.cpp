@@ -3,6 +3,12 @@
 
 BitHolder::~BitHolder()
 {
+	// the bit we hold goes with us, unless it has already moved on to another holder
+	if (_bit && _bit->getParent() == this)
+	{
+		delete _bit;
+	}
+	_bit = nullptr;
 }
 
 //
@@ -35,6 +41,7 @@ void BitHolder::setBit(Bit *abit)
 		if (_bit)
 		{
 			_bit->setParent(this);
+			_bit->setGroup(getGroup());
 		}
 	}
 }
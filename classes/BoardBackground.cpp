@@ -0,0 +1,166 @@
+#include "BoardBackground.h"
+#include "Sprite.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    // FNV-1a, fed a value at a time
+    void mix(uint64_t &key, const void *data, size_t bytes)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < bytes; i++) {
+            key = (key ^ p[i]) * 1099511628211ull;
+        }
+    }
+
+    // the texel at u, v (in texels) with bilinear filtering, clamped at the edges
+    void sample(const unsigned char *pixels, int width, int height, float u, float v, float out[4])
+    {
+        u = std::min(std::max(u, 0.0f), (float)(width - 1));
+        v = std::min(std::max(v, 0.0f), (float)(height - 1));
+        int x0 = (int)u, y0 = (int)v;
+        int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+        float fx = u - x0, fy = v - y0;
+        const unsigned char *a = pixels + ((size_t)y0 * width + x0) * 4;
+        const unsigned char *b = pixels + ((size_t)y0 * width + x1) * 4;
+        const unsigned char *c = pixels + ((size_t)y1 * width + x0) * 4;
+        const unsigned char *d = pixels + ((size_t)y1 * width + x1) * 4;
+        for (int i = 0; i < 4; i++) {
+            float top = a[i] + (b[i] - a[i]) * fx;
+            float bottom = c[i] + (d[i] - c[i]) * fx;
+            out[i] = top + (bottom - top) * fy;
+        }
+    }
+}
+
+BoardBackground::~BoardBackground()
+{
+    invalidate();
+}
+
+void BoardBackground::invalidate()
+{
+    if (_texture) {
+        Sprite::releaseTexture(_texture);
+        _texture = 0;
+    }
+    _key = 0;
+    _bakeable = true;
+}
+
+void BoardBackground::paint(SpriteStore &sprites, int group)
+{
+    const uint16_t squares = SpriteStore::Piece | SpriteStore::Hidden;
+
+    // fingerprint what a bake would draw, and where
+    uint64_t key = 14695981039346656037ull;
+    ImVec2 min(FLT_MAX, FLT_MAX);
+    ImVec2 max(-FLT_MAX, -FLT_MAX);
+    sprites.forEach(group, squares, 0, [&](SpriteStore::Handle handle) {
+        const ImVec2 &position = sprites.positions[handle];
+        const ImVec2 &size = sprites.sizes[handle];
+        mix(key, &handle, sizeof(handle));
+        mix(key, &position, sizeof(position));
+        mix(key, &size, sizeof(size));
+        mix(key, &sprites.colors[handle], sizeof(ImVec4));
+        mix(key, &sprites.textures[handle], sizeof(ImTextureID));
+        if (size.x > 0.0f && size.y > 0.0f) {
+            min = ImVec2(std::min(min.x, position.x), std::min(min.y, position.y));
+            max = ImVec2(std::max(max.x, position.x + size.x), std::max(max.y, position.y + size.y));
+        }
+    });
+    if (key != _key) {
+        _key = key;
+        _bakeable = min.x < max.x && bake(sprites, group, min, (int)std::ceil(max.x - min.x), (int)std::ceil(max.y - min.y));
+    }
+
+    if (!_bakeable) {
+        sprites.forEach(group, squares, 0, [&sprites](SpriteStore::Handle handle) {
+            sprites.paint(handle);
+        });
+        return;
+    }
+    ImGui::SetCursorPos(_origin);
+    ImGui::Image(_texture, _size);
+
+    // borders the way ImGui::Image draws them, around the square
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    sprites.forEach(group, squares | SpriteStore::Highlighted, SpriteStore::Highlighted, [&sprites, drawList](SpriteStore::Handle handle) {
+        const ImVec2 &size = sprites.sizes[handle];
+        if (size.x > 0.0f && size.y > 0.0f) {
+            ImGui::SetCursorPos(sprites.positions[handle]);
+            ImVec2 corner = ImGui::GetCursorScreenPos();
+            drawList->AddRect(corner, ImVec2(corner.x + size.x + 2, corner.y + size.y + 2), IM_COL32(255, 255, 0, 255));
+        }
+    });
+}
+
+//
+// composite the squares in painting order, tinted and blended the way the GPU would draw them
+//
+bool BoardBackground::bake(SpriteStore &sprites, int group, const ImVec2 &origin, int width, int height)
+{
+    std::vector<unsigned char> image((size_t)width * height * 4, 0);
+    bool complete = true;
+    sprites.forEach(group, SpriteStore::Piece | SpriteStore::Hidden, 0, [&](SpriteStore::Handle handle) {
+        const ImVec2 &size = sprites.sizes[handle];
+        if (!complete || size.x <= 0.0f || size.y <= 0.0f) return;
+        int textureWidth, textureHeight;
+        const unsigned char *pixels = SpriteStore::texturePixels(sprites.textures[handle], textureWidth, textureHeight);
+        if (!pixels) {
+            complete = false;
+            return;
+        }
+        const ImVec4 &tint = sprites.colors[handle];
+        float left = sprites.positions[handle].x - origin.x;
+        float top = sprites.positions[handle].y - origin.y;
+        int x0 = std::max(0, (int)std::floor(left)), x1 = std::min(width, (int)std::ceil(left + size.x));
+        int y0 = std::max(0, (int)std::floor(top)), y1 = std::min(height, (int)std::ceil(top + size.y));
+        // squares are usually drawn pixel aligned at their texture's size, no filtering needed then
+        bool exact = size.x == textureWidth && size.y == textureHeight && left == x0 && top == y0;
+        for (int y = y0; y < y1; y++) {
+            float v = (y + 0.5f - top) / size.y * textureHeight - 0.5f;
+            for (int x = x0; x < x1; x++) {
+                float texel[4];
+                if (exact) {
+                    const unsigned char *p = pixels + ((size_t)(y - y0) * textureWidth + (x - x0)) * 4;
+                    texel[0] = p[0];
+                    texel[1] = p[1];
+                    texel[2] = p[2];
+                    texel[3] = p[3];
+                } else {
+                    float u = (x + 0.5f - left) / size.x * textureWidth - 0.5f;
+                    sample(pixels, textureWidth, textureHeight, u, v, texel);
+                }
+                // straight alpha over what is already there, squares are mostly opaque
+                float alpha = texel[3] / 255.0f * tint.w;
+                unsigned char *dst = &image[((size_t)y * width + x) * 4];
+                float colour[3] = {texel[0] * tint.x, texel[1] * tint.y, texel[2] * tint.z};
+                if (alpha >= 1.0f || dst[3] == 0) {
+                    for (int c = 0; c < 3; c++) dst[c] = (unsigned char)(colour[c] + 0.5f);
+                    dst[3] = (unsigned char)(alpha * 255.0f + 0.5f);
+                } else if (alpha > 0.0f) {
+                    float below = dst[3] / 255.0f * (1.0f - alpha);
+                    float total = alpha + below;
+                    for (int c = 0; c < 3; c++) dst[c] = (unsigned char)((colour[c] * alpha + dst[c] * below) / total + 0.5f);
+                    dst[3] = (unsigned char)(total * 255.0f + 0.5f);
+                }
+            }
+        }
+    });
+    if (_texture) {
+        Sprite::releaseTexture(_texture);
+        _texture = 0;
+    }
+    if (!complete) {
+        return false;
+    }
+
+    _texture = Sprite::createTexture(image.data(), width, height);
+    _origin = origin;
+    _size = ImVec2((float)width, (float)height);
+    return _texture != 0;
+}
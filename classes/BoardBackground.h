@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SpriteStore.h"
+#include <cstdint>
+
+//
+// a board's squares baked into one offscreen texture
+// the squares only change when the layout does or a square is tinted, so rather than
+// drawing every square every frame, paint() composites them once on the CPU from the
+// textures' kept pixels, uploads the result and then draws a single image. each
+// frame it fingerprints what it baked (positions, sizes, textures, tints, visibility)
+// in one sweep of the store's columns and bakes again only when that changes.
+// highlight borders are drawn on top every frame, they never need a bake.
+// squares whose textures have no pixels kept are painted one by one as before
+//
+class BoardBackground
+{
+public:
+    BoardBackground() : _key(0), _texture(0), _origin(0, 0), _size(0, 0), _bakeable(true) {}
+    ~BoardBackground();
+    BoardBackground(const BoardBackground &) = delete;
+    BoardBackground &operator=(const BoardBackground &) = delete;
+
+    // paint the group's visible squares (the sprites that aren't pieces)
+    void paint(SpriteStore &sprites, int group);
+    // throw the baked texture away, the next paint bakes afresh
+    void invalidate();
+
+private:
+    bool bake(SpriteStore &sprites, int group, const ImVec2 &origin, int width, int height);
+
+    uint64_t _key;
+    ImTextureID _texture;
+    ImVec2 _origin;
+    ImVec2 _size;
+    // false once a bake found a square it has no pixels for, until the squares change
+    bool _bakeable;
+};
@@ -6,9 +6,12 @@ Checkers::Checkers() : Game() {
     _jumpingPiece = nullptr;
     _redPieces = 12;
     _yellowPieces = 12;
+    _legalMovesValid = false;
 }
 
 Checkers::~Checkers() {
+    // a background search still refers to our rules
+    stopPondering();
     delete _grid;
 }
 
@@ -38,6 +41,11 @@ void Checkers::setUpBoard() {
         }
     });
 
+    if (gameHasAI()) {
+        setAIPlayer(AI_PLAYER);
+    }
+
+    _legalMovesValid = false;
     startGame();
 }
 
@@ -56,65 +64,47 @@ bool Checkers::actionForEmptyHolder(BitHolder &holder) {
     return false; // Checkers doesn't place new pieces
 }
 
+//
+// work out the turn's legal moves once, the drag code asks every frame
+//
+void Checkers::refreshLegalMoves() {
+    if (_legalMovesValid) return;
+    _legalMoves.clear();
+    _rules.generateMoves(searchState(), _legalMoves);
+    _legalSources = 0;
+    for (int move : _legalMoves) {
+        int from = move / 32;
+        if (!(_legalSources & (1u << from))) _legalTargets[from] = 0;
+        _legalSources |= 1u << from;
+        _legalTargets[from] |= 1u << (move % 32);
+    }
+    _legalMovesValid = true;
+}
+
+int Checkers::squareIndexOf(BitHolder& holder) const {
+    ChessSquare* square = static_cast<ChessSquare*>(&holder);
+    if (!_grid->isEnabled(square->getColumn(), square->getRow())) return -1;
+    return CheckersRules::squareIndex(square->getColumn(), square->getRow());
+}
+
 bool Checkers::canBitMoveFrom(Bit &bit, BitHolder &src) {
     if (!src.bit() || bit.getOwner() != getCurrentPlayer()) return false;
-    if (_mustContinueJumping && &src != _jumpingPiece) return false;
-
-    ChessSquare* square = static_cast<ChessSquare*>(&src);
-    int x = square->getColumn();
-    int y = square->getRow();
+    int from = squareIndexOf(src);
+    if (from < 0) return false;
 
-    // Must jump if available
-    if (hasJumpAvailable(bit.getOwner())) {
-        return canJumpFrom(*square);
-    }
-    return true;
+    // forced captures and multi-jump continuations are already in the list
+    refreshLegalMoves();
+    return (_legalSources >> from) & 1;
 }
 
 bool Checkers::canBitMoveFromTo(Bit& bit, BitHolder& src, BitHolder& dst) {
     if (!src.bit() || dst.bit()) return false;
+    int from = squareIndexOf(src);
+    int to = squareIndexOf(dst);
+    if (from < 0 || to < 0) return false;
 
-    ChessSquare* srcSquare = static_cast<ChessSquare*>(&src);
-    ChessSquare* dstSquare = static_cast<ChessSquare*>(&dst);
-
-    int srcX = srcSquare->getColumn();
-    int srcY = srcSquare->getRow();
-
-    if (!_grid->isEnabled(dstSquare->getColumn(), dstSquare->getRow())) return false;
-
-    bool isKing = (bit.gameTag() == RED_KING || bit.gameTag() == YELLOW_KING);
-    bool isRed = (bit.getOwner() == getPlayerAt(RED_PLAYER));
-
-    // Simple moves (if no jumps required)
-    if (!_mustContinueJumping && !hasJumpAvailable(bit.getOwner())) {
-        if (isKing) {
-            return dstSquare == _grid->getFL(srcX, srcY) || dstSquare == _grid->getFR(srcX, srcY) ||
-                   dstSquare == _grid->getBL(srcX, srcY) || dstSquare == _grid->getBR(srcX, srcY);
-        }
-        return isRed ? (dstSquare == _grid->getBL(srcX, srcY) || dstSquare == _grid->getBR(srcX, srcY)) :
-                       (dstSquare == _grid->getFL(srcX, srcY) || dstSquare == _grid->getFR(srcX, srcY));
-    }
-
-    // Jump moves
-    if (_mustContinueJumping && &src != _jumpingPiece) return false;
-
-    // Check all jump directions
-    auto checkJump = [&](ChessSquare* middle, ChessSquare* target) -> bool {
-        if (!middle || !target || !middle->bit()) return false;
-        if (middle->bit()->getOwner() == bit.getOwner()) return false;
-        return dstSquare == target;
-    };
-
-    if (isKing || !isRed) {
-        if (checkJump(_grid->getFL(srcX, srcY), _grid->getFLFL(srcX, srcY))) return true;
-        if (checkJump(_grid->getFR(srcX, srcY), _grid->getFRFR(srcX, srcY))) return true;
-    }
-    if (isKing || isRed) {
-        if (checkJump(_grid->getBL(srcX, srcY), _grid->getBLBL(srcX, srcY))) return true;
-        if (checkJump(_grid->getBR(srcX, srcY), _grid->getBRBR(srcX, srcY))) return true;
-    }
-
-    return false;
+    refreshLegalMoves();
+    return ((_legalSources >> from) & 1) && ((_legalTargets[from] >> to) & 1);
 }
 
 void Checkers::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) {
@@ -125,6 +115,12 @@ void Checkers::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) {
     int srcY = srcSquare->getRow();
     int dstX = dstSquare->getColumn();
     int dstY = dstSquare->getRow();
+    _legalMovesValid = false;
+
+    // the piece has already left src, record both squares as they were
+    beginMove();
+    recordSquare(_grid->getIndex(srcX, srcY), (char)('0' + bit.gameTag()));
+    recordSquare(_grid->getIndex(dstX, dstY), '0');
 
     // Check for jump
     ChessSquare* jumped = nullptr;
@@ -135,6 +131,7 @@ void Checkers::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) {
 
     if (jumped && jumped->bit()) {
         // Capture
+        recordSquare(_grid->getIndex(jumped->getColumn(), jumped->getRow()));
         (jumped->bit()->getOwner() == getPlayerAt(RED_PLAYER)) ? _redPieces-- : _yellowPieces--;
         jumped->destroyBit();
 
@@ -148,6 +145,7 @@ void Checkers::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) {
         if (canJumpFrom(*dstSquare)) {
             _mustContinueJumping = true;
             _jumpingPiece = &dst;
+            commitMove();
             return;
         }
     } else {
@@ -189,21 +187,6 @@ bool Checkers::canJumpFrom(ChessSquare& square) const {
     return false;
 }
 
-bool Checkers::hasJumpAvailable(Player* player) const {
-    bool hasJump = false;
-    _grid->forEachEnabledSquare([&](ChessSquare* square, int x, int y) {
-        if (hasJump) return;
-        Bit* piece = square->bit();
-        if (piece && piece->getOwner() == player) {
-            Checkers* self = const_cast<Checkers*>(this);
-            if (self->canJumpFrom(*square)) {
-                hasJump = true;
-            }
-        }
-    });
-    return hasJump;
-}
-
 Player* Checkers::checkForWinner() {
     if (_redPieces == 0) return getPlayerAt(YELLOW_PLAYER);
     if (_yellowPieces == 0) return getPlayerAt(RED_PLAYER);
@@ -245,6 +228,18 @@ Player* Checkers::checkForWinner() {
     return nullptr;
 }
 
+//
+// the piece counts are kept up to date, and the next turn needs its legal
+// moves anyway, so no separate scan for a player who is stuck
+//
+int Checkers::lastMoveResult() {
+    if (_redPieces == 0) return YELLOW_PLAYER;
+    if (_yellowPieces == 0) return RED_PLAYER;
+    refreshLegalMoves();
+    if (_legalMoves.empty()) return 1 - getCurrentPlayer()->playerNumber();
+    return MCTSRules::Ongoing;
+}
+
 bool Checkers::checkForDraw() {
     return false;
 }
@@ -257,6 +252,8 @@ void Checkers::stopGame() {
     _jumpingPiece = nullptr;
     _redPieces = 12;
     _yellowPieces = 12;
+    _legalMovesValid = false;
+    forgetLooseBits();
 }
 
 std::string Checkers::initialStateString() {
@@ -267,28 +264,220 @@ std::string Checkers::stateString() {
     return _grid->getStateString();
 }
 
+//
+// only touch the squares that differ from the board, the piece counts follow along
+//
 void Checkers::setStateString(const std::string &s) {
     if (s.length() != 32) return;
 
-    _redPieces = 0;
-    _yellowPieces = 0;
-
-    _grid->setStateString(s);
-
-    // Recreate pieces from state
+    clearMoveHistory();
+    std::string current = stateString();
     size_t index = 0;
     _grid->forEachEnabledSquare([&](ChessSquare* square, int x, int y) {
-        if (index < s.length()) {
-            int pieceType = s[index++] - '0';
-            if (pieceType != 0) {
-                Bit* piece = createPiece(pieceType);
-                piece->setPosition(square->getPosition());
-                square->setBit(piece);
-                (pieceType == RED_PIECE || pieceType == RED_KING) ? _redPieces++ : _yellowPieces++;
-            }
-        }
+        if (current[index] != s[index]) setSquareState(_grid->getIndex(x, y), s[index]);
+        index++;
     });
 }
 
-void Checkers::updateAI() {}
+char Checkers::squareState(int index) {
+    Bit* bit = _grid->getSquareByIndex(index)->bit();
+    return bit ? (char)('0' + bit->gameTag()) : '0';
+}
+
+//
+// a man that changed into a king of the same color is retagged in place like a
+// promotion, anything else is removed or recreated
+//
+void Checkers::setSquareState(int index, char state) {
+    ChessSquare* square = _grid->getSquareByIndex(index);
+    int pieceType = state - '0';
+    if (pieceType < RED_PIECE || pieceType > YELLOW_KING) pieceType = EMPTY;
+    auto isRed = [](int type) { return type == RED_PIECE || type == RED_KING; };
+    _legalMovesValid = false;
+
+    Bit* bit = square->bit();
+    if (bit && pieceType != EMPTY && isRed(pieceType) == isRed(bit->gameTag())) {
+        bit->setGameTag(pieceType);
+        bit->setScale(pieceType == RED_KING || pieceType == YELLOW_KING ? 1.3f : 1.0f);
+        return;
+    }
+    if (bit) {
+        isRed(bit->gameTag()) ? _redPieces-- : _yellowPieces--;
+        square->destroyBit();
+    }
+    if (pieceType != EMPTY) {
+        Bit* piece = createPiece(pieceType);
+        piece->setPosition(square->getPosition());
+        square->setBit(piece);
+        isRed(pieceType) ? _redPieces++ : _yellowPieces++;
+    }
+}
+
+// the square a multi-jump has to continue from, -1 when there is none
+int Checkers::moveExtra() {
+    if (!_mustContinueJumping || !_jumpingPiece) return -1;
+    ChessSquare* square = static_cast<ChessSquare*>(_jumpingPiece);
+    return _grid->getIndex(square->getColumn(), square->getRow());
+}
+
+void Checkers::setMoveExtra(int extra) {
+    _mustContinueJumping = extra >= 0;
+    _jumpingPiece = extra >= 0 ? _grid->getSquareByIndex(extra) : nullptr;
+    _legalMovesValid = false;
+}
+
+std::string Checkers::searchState() {
+    std::string state = stateString();
+    state += (char)('0' + getCurrentPlayer()->playerNumber());
+    if (_mustContinueJumping && _jumpingPiece) {
+        ChessSquare* square = static_cast<ChessSquare*>(_jumpingPiece);
+        state += (char)('a' + CheckersRules::squareIndex(square->getColumn(), square->getRow()));
+    } else {
+        state += '-';
+    }
+    return state;
+}
+
+//
+// play the move the same way a finished drag does
+//
+void Checkers::applySearchMove(int move) {
+    int from = move / 32;
+    int to = move % 32;
+    ChessSquare* src = _grid->getSquare(CheckersRules::squareX(from), CheckersRules::squareY(from));
+    ChessSquare* dst = _grid->getSquare(CheckersRules::squareX(to), CheckersRules::squareY(to));
+    Bit* bit = src ? src->bit() : nullptr;
+    if (!bit || !dst) return;
+
+    if (dst->dropBitAtPoint(bit, dst->getPosition())) {
+        src->draggedBitTo(bit, dst);
+        bitMovedFromTo(*bit, *src, *dst);
+    }
+}
+
+//
+// a forced move (often a capture) needs no search
+//
+void Checkers::updateAI() {
+    refreshLegalMoves();
+    if (_legalMoves.size() == 1) {
+        stopPondering();
+        applySearchMove(_legalMoves[0]);
+        return;
+    }
+    Game::updateAI();
+}
+
+//
+// search rules: '1'/'2' are red men/kings (player 0), '3'/'4' yellow men/kings (player 1)
+// red moves down the board and yellow moves up
+//
+int CheckersRules::currentPlayer(const std::string &state) const {
+    return state[32] - '0';
+}
 
+void CheckersRules::movesFrom(const std::string &state, int index, bool jumpsOnly, std::vector<int> &moves) const {
+    char piece = state[index];
+    bool red = (piece == '1' || piece == '2');
+    bool king = (piece == '2' || piece == '4');
+    int x = squareX(index);
+    int y = squareY(index);
+    const int dirs[4][2] = {{-1,1},{1,1},{-1,-1},{1,-1}};
+    for (int d = 0; d < 4; d++) {
+        int dx = dirs[d][0];
+        int dy = dirs[d][1];
+        if (!king && (dy > 0) != red) continue;
+
+        int nx = x + dx, ny = y + dy;
+        if (nx < 0 || nx > 7 || ny < 0 || ny > 7) continue;
+        char middle = state[squareIndex(nx, ny)];
+        if (middle == '0' || middle == '-') {
+            if (!jumpsOnly) moves.push_back(index * 32 + squareIndex(nx, ny));
+            continue;
+        }
+        bool middleRed = (middle == '1' || middle == '2');
+        int jx = x + 2 * dx, jy = y + 2 * dy;
+        if (middleRed == red || jx < 0 || jx > 7 || jy < 0 || jy > 7) continue;
+        char landing = state[squareIndex(jx, jy)];
+        if (landing == '0' || landing == '-') {
+            moves.push_back(index * 32 + squareIndex(jx, jy));
+        }
+    }
+}
+
+void CheckersRules::generateMoves(const std::string &state, std::vector<int> &moves) const {
+    if (state[33] != '-') {
+        movesFrom(state, state[33] - 'a', true, moves);
+        return;
+    }
+
+    // captures are forced, so only fall back to simple moves when there are none
+    bool red = currentPlayer(state) == 0;
+    for (int i = 0; i < 32; i++) {
+        char piece = state[i];
+        if (piece == '0' || piece == '-') continue;
+        if ((piece == '1' || piece == '2') == red) movesFrom(state, i, true, moves);
+    }
+    if (!moves.empty()) return;
+    for (int i = 0; i < 32; i++) {
+        char piece = state[i];
+        if (piece == '0' || piece == '-') continue;
+        if ((piece == '1' || piece == '2') == red) movesFrom(state, i, false, moves);
+    }
+}
+
+void CheckersRules::playMove(std::string &state, int move) const {
+    int from = move / 32;
+    int to = move % 32;
+    char piece = state[from];
+    state[from] = '0';
+
+    bool jump = std::abs(squareY(to) - squareY(from)) == 2;
+    if (jump) {
+        state[squareIndex((squareX(from) + squareX(to)) / 2, (squareY(from) + squareY(to)) / 2)] = '0';
+    }
+    if (piece == '1' && squareY(to) == 7) piece = '2';
+    if (piece == '3' && squareY(to) == 0) piece = '4';
+    state[to] = piece;
+
+    // a capturing piece that can capture again keeps the turn
+    if (jump) {
+        std::vector<int> more;
+        movesFrom(state, to, true, more);
+        if (!more.empty()) {
+            state[33] = (char)('a' + to);
+            return;
+        }
+    }
+    state[32] = (char)('0' + (1 - currentPlayer(state)));
+    state[33] = '-';
+}
+
+int CheckersRules::result(const std::string &state) const {
+    std::vector<int> moves;
+    generateMoves(state, moves);
+    if (moves.empty()) {
+        return 1 - currentPlayer(state);
+    }
+    return Ongoing;
+}
+
+int CheckersRules::evaluate(const std::string &state) const {
+    // material, with a king worth about one and a half men
+    bool red = currentPlayer(state) == 0;
+    int score = 0;
+    for (int i = 0; i < 32; i++) {
+        char piece = state[i];
+        if (piece == '0' || piece == '-') continue;
+        int value = (piece == '2' || piece == '4') ? 150 : 100;
+        score += ((piece == '1' || piece == '2') == red) ? value : -value;
+    }
+    return score;
+}
+
+std::string CheckersRules::moveName(int move) const {
+    auto square = [](int index) {
+        return std::string(1, (char)('a' + squareX(index))) + std::to_string(8 - squareY(index));
+    };
+    return square(move / 32) + "-" + square(move % 32);
+}
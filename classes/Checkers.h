@@ -4,6 +4,31 @@
 // NOTE: If Square class needs modifications to support colored squares for checkerboard pattern,
 // add a method like setColor(ImVec4 color) to Square class
 
+//
+// checkers rules for MCTS
+// the position is the 32 dark squares of the state string, then the player to
+// move, then the square a multi-jump must continue from ('-' when there is none)
+// moves are encoded as from * 32 + to
+//
+class CheckersRules : public MCTSRules
+{
+public:
+    int         currentPlayer(const std::string &state) const override;
+    void        generateMoves(const std::string &state, std::vector<int> &moves) const override;
+    void        playMove(std::string &state, int move) const override;
+    int         result(const std::string &state) const override;
+    int         evaluate(const std::string &state) const override;
+    std::string moveName(int move) const override;
+
+    // dark square index <-> board coordinates
+    static int  squareIndex(int x, int y) { return y * 4 + x / 2; }
+    static int  squareX(int index) { return (index % 4) * 2 + ((index / 4) % 2 == 0 ? 1 : 0); }
+    static int  squareY(int index) { return index / 4; }
+
+private:
+    void        movesFrom(const std::string &state, int index, bool jumpsOnly, std::vector<int> &moves) const;
+};
+
 class Checkers : public Game
 {
 public:
@@ -14,6 +39,7 @@ public:
     void        setUpBoard() override;
     Player*     checkForWinner() override;
     bool        checkForDraw() override;
+    int         lastMoveResult() override;
     std::string initialStateString() override;
     std::string stateString() override;
     void        setStateString(const std::string &s) override;
@@ -23,10 +49,19 @@ public:
     void        stopGame() override;
     void        bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
 
-    // AI methods
-    void        updateAI() override;
-    bool        gameHasAI() override { return false; } // Set to true when AI is implemented
+    // AI methods, played by MCTS through the search rules
+    bool        gameHasAI() override { return true; }
     Grid* getGrid() override { return _grid; }
+    MCTSRules*  searchRules() override { return &_rules; }
+    std::string searchState() override;
+    void        applySearchMove(int move) override;
+    void        updateAI() override;
+
+protected:
+    char        squareState(int index) override;
+    void        setSquareState(int index, char state) override;
+    int         moveExtra() override;
+    void        setMoveExtra(int extra) override;
 
 private:
     // Constants for piece types
@@ -46,8 +81,9 @@ private:
     bool        isKing(const Bit& bit) const;
     bool        isValidMove(int srcX, int srcY, int dstX, int dstY, Player* player) const;
     bool        isJumpMove(int srcX, int srcY, int dstX, int dstY) const;
-    bool        hasJumpAvailable(Player* player) const;
     bool        canJumpFrom(ChessSquare& square) const;
+    void        refreshLegalMoves();
+    int         squareIndexOf(BitHolder& holder) const;
     void        performJump(int srcX, int srcY, int dstX, int dstY);
     void        promoteToKing(Bit& bit, int y);
     void        getBoardPosition(BitHolder &holder, int &x, int &y) const;
@@ -55,10 +91,19 @@ private:
 
     // Board representation
     Grid*        _grid;
+    CheckersRules _rules;
 
     // Game state
     bool        _mustContinueJumping;
     BitHolder*  _jumpingPiece;
     int         _redPieces;
     int         _yellowPieces;
+
+    // every legal move of the turn (forced captures and multi-jump continuations
+    // included), worked out once from the search rules and shared by drag
+    // validation and the AI. invalidated whenever the board changes
+    bool        _legalMovesValid;
+    uint32_t    _legalSources;          // bit per dark square that has a legal move
+    uint32_t    _legalTargets[32];      // for each of those, the squares it can reach
+    std::vector<int> _legalMoves;
 };
\ No newline at end of file
@@ -51,10 +51,11 @@ void ChessSquare::setHighlighted(bool highlighted)
 {
     Sprite::setHighlighted(highlighted);
     int odd = (_column + _row) % 2;
-    _color = odd ? ImVec4(0.93, 0.93, 0.84, 1.0) : ImVec4(0.48, 0.58, 0.36, 1.0);
+    ImVec4 color = odd ? ImVec4(0.93, 0.93, 0.84, 1.0) : ImVec4(0.48, 0.58, 0.36, 1.0);
     if (highlighted)
     {
-        _color = odd ? ImVec4(0.48, 0.58, 0.36, 1.0) : ImVec4(0.93, 0.93, 0.84, 1.0);
-        _color = Lerp(_color, ImVec4(0.75, 0.79, 0.30, 1.0), 0.75);
+        color = odd ? ImVec4(0.48, 0.58, 0.36, 1.0) : ImVec4(0.93, 0.93, 0.84, 1.0);
+        color = Lerp(color, ImVec4(0.75, 0.79, 0.30, 1.0), 0.75);
     }
+    setColor(color);
 }
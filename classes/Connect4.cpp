@@ -1,4 +1,6 @@
 #include "Connect4.h"
+#include "Connect4Knowledge.h"
+#include "ThreadPool.h"
 
 #include <vector>
 #include <algorithm>
@@ -6,9 +8,14 @@
 
 Connect4::Connect4() : Game() {
     _grid = new Grid(CONNECT4_COLS, CONNECT4_ROWS);
+    _ponderCancel = false;
+    _replyCancel = false;
+    _lastMoveX = -1;
+    _lastMoveY = -1;
 }
 
 Connect4::~Connect4() {
+    stopPondering();
     delete _grid;
 }
 
@@ -23,6 +30,8 @@ void Connect4::setUpBoard() {
         setAIPlayer(AI_PLAYER);
     }
 
+    _lastMoveX = -1;
+    _lastMoveY = -1;
     startGame();
 }
 
@@ -72,6 +81,8 @@ bool Connect4::actionForEmptyHolder(BitHolder &holder) {
     ChessSquare* dest = _grid->getSquare(col, row);
     if (!dest) return false;
 
+    beginMove();
+    recordSquare(_grid->getIndex(col, row));
     Bit* bit = createPiece(getCurrentPlayer());
     ImVec2 target = dest->getPosition();
     ImVec2 start = ImVec2(target.x, target.y - 80.0f * (row + 1));
@@ -79,12 +90,14 @@ bool Connect4::actionForEmptyHolder(BitHolder &holder) {
     dest->setBit(bit);
     bit->moveTo(target);
 
-    if (checkForWinner() || checkForDraw()) {
-        endTurn();
-        return true;
-    }
-
+    _lastMoveX = col;
+    _lastMoveY = row;
     endTurn();
+
+    // think about the reply while this piece is still falling
+    if (_gameOptions.AIPlaying && _gameOptions.AIFrameBudget == 0 && !isGameOver() && getCurrentPlayer() == getPlayerAt(AI_PLAYER)) {
+        startReplySearch();
+    }
     return true;
 }
 
@@ -130,6 +143,31 @@ Player* Connect4::checkForWinner() {
     return winner;
 }
 
+//
+// only lines through the stone just dropped can have been completed
+//
+int Connect4::lastMoveResult() {
+    ChessSquare* square = _grid->getSquare(_lastMoveX, _lastMoveY);
+    if (!square || !square->bit()) return Game::lastMoveResult();
+
+    Player* owner = square->bit()->getOwner();
+    const int dirs[4][2] = {{1,0},{0,1},{1,1},{1,-1}};
+    for (int i = 0; i < 4; ++i) {
+        int dx = dirs[i][0];
+        int dy = dirs[i][1];
+        int total = 1 + countConsecutive(_lastMoveX, _lastMoveY, dx, dy, owner) + countConsecutive(_lastMoveX, _lastMoveY, -dx, -dy, owner);
+        if (total >= 4) {
+            _winner = owner;
+            return owner->playerNumber();
+        }
+    }
+    // the board is full once the top row is
+    for (int x = 0; x < CONNECT4_COLS; ++x) {
+        if (!_grid->getSquare(x, 0)->bit()) return MCTSRules::Ongoing;
+    }
+    return MCTSRules::Draw;
+}
+
 bool Connect4::checkForDraw() {
     for (int y = 0; y < CONNECT4_ROWS; ++y) {
         for (int x = 0; x < CONNECT4_COLS; ++x) {
@@ -142,12 +180,14 @@ bool Connect4::checkForDraw() {
 }
 
 void Connect4::stopGame() {
+    stopPondering();
     for (int y = 0; y < CONNECT4_ROWS; ++y) {
         for (int x = 0; x < CONNECT4_COLS; ++x) {
             ChessSquare* sq = _grid->getSquare(x, y);
             if (sq) sq->destroyBit();
         }
     }
+    forgetLooseBits();
 }
 
 std::string Connect4::initialStateString() {
@@ -169,28 +209,49 @@ std::string Connect4::stateString() {
     return s;
 }
 
+//
+// only touch the squares that differ from the board, so replaying a search
+// line or undoing a move costs the pieces that changed, not the whole board
+//
 void Connect4::setStateString(const std::string &s) {
     if ((int)s.length() != CONNECT4_COLS * CONNECT4_ROWS) return;
-    int index = 0;
-    for (int y = 0; y < CONNECT4_ROWS; ++y) {
-        for (int x = 0; x < CONNECT4_COLS; ++x) {
-            if (index >= (int)s.length()) break;
-            char c = s[index++];
-            ChessSquare* square = _grid->getSquare(x, y);
-            if (!square) continue;
-            square->destroyBit();
-            if (c == '1') {
-                Bit* piece = createPiece(RED_PIECE);
-                piece->setPosition(square->getPosition());
-                square->setBit(piece);
-            } else if (c == '2') {
-                Bit* piece = createPiece(YELLOW_PIECE);
-                piece->setPosition(square->getPosition());
-                square->setBit(piece);
-            }
-        }
+    _lastMoveX = -1;
+    _lastMoveY = -1;
+    clearMoveHistory();
+    std::string current = stateString();
+    for (int index = 0; index < (int)s.length(); ++index) {
+        if (current[index] != s[index]) setSquareState(index, s[index]);
     }
 }
+
+char Connect4::squareState(int index) {
+    ChessSquare* square = _grid->getSquareByIndex(index);
+    Bit* bit = square ? square->bit() : nullptr;
+    if (!bit) return '0';
+    return bit->gameTag() == RED_PIECE ? '1' : '2';
+}
+
+void Connect4::setSquareState(int index, char state) {
+    ChessSquare* square = _grid->getSquareByIndex(index);
+    if (!square) return;
+    square->destroyBit();
+    if (state == '1' || state == '2') {
+        Bit* piece = createPiece(state == '1' ? RED_PIECE : YELLOW_PIECE);
+        piece->setPosition(square->getPosition());
+        square->setBit(piece);
+    }
+}
+
+// the last move, as a grid index, is all the win check needs after an undo or redo
+int Connect4::moveExtra() {
+    return _lastMoveX < 0 ? -1 : _grid->getIndex(_lastMoveX, _lastMoveY);
+}
+
+void Connect4::setMoveExtra(int extra) {
+    _lastMoveX = extra < 0 ? -1 : extra % CONNECT4_COLS;
+    _lastMoveY = extra < 0 ? -1 : extra / CONNECT4_COLS;
+}
+
 /*This Ai uses the windowed method that the professor mentioned in class. 
 Although it took a while by looking around to try and try to understand it how it would work.
 it also uses the alpha-beta method and should fully work.
@@ -304,16 +365,39 @@ static int evaluateAIBoard(const std::string& state) {
     return score;
 }
 
-int Connect4::negamax(std::string& state, int depth, int playerColor) {
+// root moves are searched in parallel, so each thread keeps its own rule scratch space
+static Connect4Knowledge &threadKnowledge() {
+    static thread_local Connect4Knowledge knowledge;
+    return knowledge;
+}
+
+int Connect4::negamax(std::string& state, int depth, int playerColor, const std::atomic<bool>& cancel) {
     const int INF = std::numeric_limits<int>::max() / 4;
-    return negamax(state, depth, playerColor, -INF, INF);
+    return negamax(state, depth, playerColor, -INF, INF, cancel);
 }
 
-int Connect4::negamax(std::string& state, int depth, int playerColor, int alpha, int beta) {
+int Connect4::negamax(std::string& state, int depth, int playerColor, int alpha, int beta, const std::atomic<bool>& cancel) {
+    // a cancelled search unwinds at once, its score is thrown away
+    if (cancel.load(std::memory_order_relaxed)) return 0;
     const int MAX_DEPTH = 6;
+    // only worth proving positions with at least this many plies left to search
+    const int KNOWLEDGE_MIN_PLIES = 4;
     if (depth >= MAX_DEPTH || isAIBoardFull(state))
         return evaluateAIBoard(state) * playerColor;
 
+    // with red (the first player) to move, Allis' rules can prove red can't win,
+    // which caps this node at a draw or settles it as a loss outright
+    bool provenNoWin = false;
+    if (playerColor == -1 && MAX_DEPTH - depth >= KNOWLEDGE_MIN_PLIES) {
+        Connect4Knowledge::Result known = threadKnowledge().evaluate(state);
+        if (known == Connect4Knowledge::SecondPlayerWins) return -100000;
+        if (known == Connect4Knowledge::SecondPlayerDraws) {
+            provenNoWin = true;
+            if (beta > 0) beta = 0;
+            if (alpha >= beta) return beta;
+        }
+    }
+
     int bestVal = -1000000;
     const int rows = CONNECT4_ROWS;
     const int cols = CONNECT4_COLS;
@@ -338,55 +422,100 @@ int Connect4::negamax(std::string& state, int depth, int playerColor, int alpha,
         if (row < 0) continue;
         int idx = row * cols + col;
         state[idx] = (playerColor == 1) ? '2' : '1';
-        int val = -negamax(state, depth + 1, -playerColor, -beta, -alpha);
+        int val = -negamax(state, depth + 1, -playerColor, -beta, -alpha, cancel);
         state[idx] = '0';
 
         if (val > bestVal) bestVal = val;
         if (bestVal > alpha) alpha = bestVal;
         if (alpha >= beta) break;
     }
+    if (provenNoWin && bestVal > 0) bestVal = 0;
     return bestVal;
 }
 
-void Connect4::updateAI() {
-    if (!gameHasAI() || getCurrentPlayer() != getPlayerAt(AI_PLAYER)) return;
-
-    std::string state = stateString();
-    int bestCol = -1;
-    int bestVal = -1000000;
-
+//
+// the AI's move for yellow in the given position, -1 if the board is full or the search was cancelled
+//
+int Connect4::chooseMove(const std::string& state, const std::atomic<bool>& cancel) {
     static const int order[CONNECT4_COLS] = {3, 2, 4, 1, 5, 0, 6};
     for (int i = 0; i < CONNECT4_COLS; ++i) {
         int col = order[i];
         if (aiLowestRow(state, col) < 0) continue;
-        if (isWinningMove(state, CONNECT4_COLS, CONNECT4_ROWS, col, '2')) {
-            BitHolder* top = _grid->getSquare(col, 0);
-            if (top) { actionForEmptyHolder(*top); return; }
-        }
+        if (isWinningMove(state, CONNECT4_COLS, CONNECT4_ROWS, col, '2')) return col;
     }
 
     for (int i = 0; i < CONNECT4_COLS; ++i) {
         int col = order[i];
         if (aiLowestRow(state, col) < 0) continue;
-        if (isWinningMove(state, CONNECT4_COLS, CONNECT4_ROWS, col, '1')) {
-            BitHolder* top = _grid->getSquare(col, 0);
-            if (top) { actionForEmptyHolder(*top); return; }
-        }
+        if (isWinningMove(state, CONNECT4_COLS, CONNECT4_ROWS, col, '1')) return col;
     }
 
+    // search each root move on the shared pool, then pick in column order as before
+    ThreadPool& pool = ThreadPool::instance();
+    std::vector<std::pair<int, std::future<int>>> searches;
     for (int i = 0; i < CONNECT4_COLS; ++i) {
         int col = order[i];
         int row = aiLowestRow(state, col);
         if (row < 0) continue;
-        int idx = row * CONNECT4_COLS + col;
+        std::string child = state;
+        child[row * CONNECT4_COLS + col] = '2';
+        searches.emplace_back(col, pool.submit([this, child, &cancel]() mutable { return -negamax(child, 0, -1, cancel); }));
+    }
 
-        state[idx] = '2';
-        int val = -negamax(state, 0, -1);
-        state[idx] = '0';
+    int bestCol = -1;
+    int bestVal = -1000000;
+    for (auto& search : searches) {
+        int val = pool.wait(search.second);
+        if (val > bestVal) { bestVal = val; bestCol = search.first; }
+    }
+    return cancel ? -1 : bestCol;
+}
+
+void Connect4::startReplySearch() {
+    std::string state = stateString();
+    if (_replySearch.valid() && state == _replyState) return;
+    // a reply for an older position is worthless, it unwinds within a node
+    stopReplySearch();
+
+    // a ponder hit already has the answer. either way the human has moved, so the
+    // ponder's other replies are moot: tell it to stop but don't wait, this is the
+    // click path and it winds down on its own (the next ponder() joins it)
+    int hit = -1;
+    {
+        std::lock_guard<std::mutex> guard(_ponderLock);
+        auto found = _ponderMoves.find(state);
+        if (found != _ponderMoves.end()) hit = found->second;
+    }
+    _ponderCancel = true;
+    _replyState = state;
+    if (hit >= 0) {
+        std::promise<int> answer;
+        answer.set_value(hit);
+        _replySearch = answer.get_future();
+    } else {
+        _replyCancel = false;
+        _replySearch = ThreadPool::instance().submit([this, state]() { return chooseMove(state, _replyCancel); });
+    }
+}
 
-        if (val > bestVal) { bestVal = val; bestCol = col; }
+void Connect4::updateAI() {
+    if (!gameHasAI() || getCurrentPlayer() != getPlayerAt(AI_PLAYER)) return;
+
+    // the reply may have been searching since the human's move went in; let their piece land first
+    ChessSquare* last = _lastMoveX >= 0 ? _grid->getSquare(_lastMoveX, _lastMoveY) : nullptr;
+    if (last && last->bit() && last->bit()->getMoving()) return;
+
+    // without threads the negamax can't run beside the frame, the sliced MCTS can
+    if (_gameOptions.AIFrameBudget > 0) {
+        Game::updateAI();
+        return;
     }
 
+    // no waiting on the frame, come back next frame if the search is still going
+    startReplySearch();
+    if (_replySearch.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+    int bestCol = _replySearch.get();
+
     if (bestCol >= 0) {
         BitHolder* top = _grid->getSquare(bestCol, 0);
         if (top) actionForEmptyHolder(*top);
@@ -394,3 +523,131 @@ void Connect4::updateAI() {
         endTurn();
     }
 }
+
+//
+// while the human thinks, work out the answer to each of their replies, center out
+//
+void Connect4::ponder() {
+    if (!_gameOptions.AIPlaying || !_gameOptions.AIPonder || _gameOptions.AIFrameBudget > 0) return;
+
+    std::string state = stateString();
+    if (_ponderTask.valid() && state == _ponderState) return;
+
+    stopPondering();
+    _ponderState = state;
+    {
+        std::lock_guard<std::mutex> guard(_ponderLock);
+        _ponderMoves.clear();
+    }
+    _ponderCancel = false;
+    _ponderTask = ThreadPool::instance().submit([this, state]() {
+        static const int order[CONNECT4_COLS] = {3, 2, 4, 1, 5, 0, 6};
+        for (int i = 0; i < CONNECT4_COLS && !_ponderCancel; ++i) {
+            int col = order[i];
+            int row = aiLowestRow(state, col);
+            if (row < 0 || isWinningMove(state, CONNECT4_COLS, CONNECT4_ROWS, col, '1')) continue;
+            std::string reply = state;
+            reply[row * CONNECT4_COLS + col] = '1';
+            int answer = chooseMove(reply, _ponderCancel);
+            if (_ponderCancel) break;
+            std::lock_guard<std::mutex> guard(_ponderLock);
+            _ponderMoves[reply] = answer;
+        }
+    });
+}
+
+void Connect4::stopPondering() {
+    Game::stopPondering();
+    // both searches check their flag at every node, so neither keeps the caller waiting
+    stopReplySearch();
+    if (!_ponderTask.valid()) return;
+    _ponderCancel = true;
+    _ponderTask.get();
+}
+
+void Connect4::stopReplySearch() {
+    if (!_replySearch.valid()) return;
+    _replyCancel = true;
+    _replySearch.get();
+}
+
+void Connect4::applySearchMove(int move) {
+    BitHolder* top = _grid->getSquare(move, 0);
+    if (top) actionForEmptyHolder(*top);
+}
+
+int Connect4Rules::currentPlayer(const std::string &state) const {
+    int stones = 0;
+    for (char c : state) {
+        if (c != '0') ++stones;
+    }
+    return stones & 1;
+}
+
+void Connect4Rules::generateMoves(const std::string &state, std::vector<int> &moves) const {
+    static const int order[Connect4::CONNECT4_COLS] = {3, 2, 4, 1, 5, 0, 6};
+    for (int i = 0; i < Connect4::CONNECT4_COLS; ++i) {
+        if (state[order[i]] == '0') moves.push_back(order[i]);
+    }
+}
+
+void Connect4Rules::playMove(std::string &state, int move) const {
+    char piece = currentPlayer(state) == 0 ? '1' : '2';
+    for (int r = Connect4::CONNECT4_ROWS - 1; r >= 0; --r) {
+        int idx = r * Connect4::CONNECT4_COLS + move;
+        if (state[idx] == '0') { state[idx] = piece; return; }
+    }
+}
+
+int Connect4Rules::result(const std::string &state) const {
+    const int rows = Connect4::CONNECT4_ROWS;
+    const int cols = Connect4::CONNECT4_COLS;
+    const int dirs[4][2] = {{1,0},{0,1},{1,1},{1,-1}};
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            char p = state[r * cols + c];
+            if (p == '0') continue;
+            for (int i = 0; i < 4; ++i) {
+                int er = r + 3 * dirs[i][1];
+                int ec = c + 3 * dirs[i][0];
+                if (er < 0 || er >= rows || ec >= cols) continue;
+                if (countDirection(state, rows, cols, r, c, dirs[i][1], dirs[i][0], p) >= 3) return p == '1' ? 0 : 1;
+            }
+        }
+    }
+    return isAIBoardFull(state) ? Draw : Ongoing;
+}
+
+//
+// only lines through the stone just dropped can have been completed
+//
+int Connect4Rules::resultAfterMove(const std::string &state, int move) const {
+    const int rows = Connect4::CONNECT4_ROWS;
+    const int cols = Connect4::CONNECT4_COLS;
+    int row = 0;
+    while (row < rows && state[row * cols + move] == '0') ++row;
+    if (row == rows) return result(state);
+
+    char p = state[row * cols + move];
+    const int dirs[4][2] = {{1,0},{0,1},{1,1},{1,-1}};
+    for (int i = 0; i < 4; ++i) {
+        int dx = dirs[i][0];
+        int dy = dirs[i][1];
+        int total = 1 + countDirection(state, rows, cols, row, move, dy, dx, p) + countDirection(state, rows, cols, row, move, -dy, -dx, p);
+        if (total >= 4) return p == '1' ? 0 : 1;
+    }
+    // the board is full once the top row is
+    for (int c = 0; c < cols; ++c) {
+        if (state[c] == '0') return Ongoing;
+    }
+    return Draw;
+}
+
+int Connect4Rules::evaluate(const std::string &state) const {
+    // the board heuristic scores for yellow
+    return currentPlayer(state) == 1 ? evaluateAIBoard(state) : -evaluateAIBoard(state);
+}
+
+std::string Connect4Rules::moveName(int move) const {
+    return "column " + std::to_string(move + 1);
+}
@@ -4,7 +4,25 @@
 #include "Grid.h"
 #include "Bit.h"
 #include "ChessSquare.h"
+#include <atomic>
+#include <future>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+
+//
+// Connect 4 rules for MCTS, on the row-major state string
+//
+class Connect4Rules : public MCTSRules {
+public:
+    int currentPlayer(const std::string &state) const override;
+    void generateMoves(const std::string &state, std::vector<int> &moves) const override;
+    void playMove(std::string &state, int move) const override;
+    int result(const std::string &state) const override;
+    int resultAfterMove(const std::string &state, int move) const override;
+    int evaluate(const std::string &state) const override;
+    std::string moveName(int move) const override;
+};
 
 class Connect4 : public Game {
 public:
@@ -21,8 +39,11 @@ public:
     bool canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
     Player* checkForWinner() override;
     bool checkForDraw() override;
+    int lastMoveResult() override;
     void stopGame() override;
     void updateAI() override;
+    void ponder() override;
+    void stopPondering() override;
 
     std::string initialStateString() override;
     std::string stateString() override;
@@ -31,8 +52,37 @@ public:
     Grid* getGrid() override { return _grid; }
     bool gameHasAI() override { return true; }
 
+    MCTSRules* searchRules() override { return &_rules; }
+    void applySearchMove(int move) override;
+
+protected:
+    char squareState(int index) override;
+    void setSquareState(int index, char state) override;
+    int moveExtra() override;
+    void setMoveExtra(int extra) override;
+
 private:
     Grid* _grid;
+    Connect4Rules _rules;
+    // where the last stone landed, -1 when unknown (e.g. after setStateString)
+    int _lastMoveX;
+    int _lastMoveY;
+
+    // pondering: the AI's answer to each human reply, searched on the human's time
+    std::future<void> _ponderTask;
+    std::atomic<bool> _ponderCancel;
+    std::mutex _ponderLock;
+    std::unordered_map<std::string, int> _ponderMoves;
+    std::string _ponderState;
+
+    // the AI's reply, searched on the pool from the moment the human's move goes in
+    // so it overlaps the drop animation, and played once the piece has landed
+    std::future<int> _replySearch;
+    std::string _replyState;
+    std::atomic<bool> _replyCancel;
+    void startReplySearch();
+    // cancel the reply search and wait for it to unwind, dropping its answer
+    void stopReplySearch();
 
     static const int EMPTY = 0;
     static const int RED_PIECE = 1;
@@ -42,7 +92,8 @@ private:
     int countConsecutive(int x, int y, int dx, int dy, Player* owner) const;
     int getLowestEmptyRowForColumn(int x) const;
 
+    int chooseMove(const std::string& state, const std::atomic<bool>& cancel);
     int aiLowestRow(const std::string& state, int col);
-    int negamax(std::string& state, int depth, int playerColor);
-    int negamax(std::string& state, int depth, int playerColor, int alpha, int beta);
+    int negamax(std::string& state, int depth, int playerColor, const std::atomic<bool>& cancel);
+    int negamax(std::string& state, int depth, int playerColor, int alpha, int beta, const std::atomic<bool>& cancel);
 };
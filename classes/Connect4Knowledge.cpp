@@ -0,0 +1,415 @@
+#include "Connect4Knowledge.h"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+//
+// all 69 groups of four on the 7x6 board as square masks
+//
+struct GroupTable {
+    uint64_t mask[Connect4Knowledge::GROUP_COUNT];
+    int count;
+
+    GroupTable() : count(0) {
+        const int cols = Connect4Knowledge::COLS;
+        const int rows = Connect4Knowledge::ROWS;
+        const int dirs[4][2] = {{1,0},{0,1},{1,1},{1,-1}};
+        for (int d = 0; d < 4; ++d) {
+            for (int c = 0; c < cols; ++c) {
+                for (int r = 0; r < rows; ++r) {
+                    int ec = c + 3 * dirs[d][0];
+                    int er = r + 3 * dirs[d][1];
+                    if (ec < 0 || ec >= cols || er < 0 || er >= rows) continue;
+                    uint64_t m = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        m |= 1ULL << ((c + i * dirs[d][0]) * rows + (r + i * dirs[d][1]));
+                    }
+                    mask[count++] = m;
+                }
+            }
+        }
+    }
+};
+
+static const GroupTable &groups() {
+    static const GroupTable table;
+    return table;
+}
+
+// every square in a column above the given row
+static uint64_t columnAbove(int col, int row) {
+    uint64_t m = 0;
+    for (int r = row + 1; r < Connect4Knowledge::ROWS; ++r) {
+        m |= 1ULL << (col * Connect4Knowledge::ROWS + r);
+    }
+    return m;
+}
+
+bool Connect4Knowledge::loadState(const std::string &state) {
+    if ((int)state.size() != COLS * ROWS) return false;
+
+    _first = 0;
+    _second = 0;
+    for (int y = 0; y < ROWS; ++y) {
+        for (int x = 0; x < COLS; ++x) {
+            char c = state[y * COLS + x];
+            int sq = square(x, ROWS - 1 - y);
+            if (c == '1') _first |= bit(sq);
+            else if (c == '2') _second |= bit(sq);
+        }
+    }
+
+    // the rules assume the first player is to move on a legal position
+    if (std::popcount(_first) != std::popcount(_second)) return false;
+
+    uint64_t occupied = _first | _second;
+    _playable.clear();
+    for (int c = 0; c < COLS; ++c) {
+        int h = 0;
+        while (h < ROWS && (occupied & bit(square(c, h)))) ++h;
+        if (occupied & columnAbove(c, h)) return false;
+        _height[c] = h;
+        if (h < ROWS) _playable.push_back(square(c, h));
+    }
+
+    const GroupTable &table = groups();
+    _threats.reset();
+    for (int g = 0; g < table.count; ++g) {
+        uint64_t m = table.mask[g];
+        if ((m & _first) == m || (m & _second) == m) return false;
+        if ((m & _second) == 0) _threats.set(g);
+    }
+    return true;
+}
+
+Connect4Knowledge::GroupSet Connect4Knowledge::groupsContaining(uint64_t mask) const {
+    const GroupTable &table = groups();
+    GroupSet result;
+    for (int g = 0; g < table.count; ++g) {
+        if (_threats[g] && (table.mask[g] & mask) == mask) result.set(g);
+    }
+    return result;
+}
+
+Connect4Knowledge::GroupSet Connect4Knowledge::groupsAbove(const int minRow[COLS]) const {
+    uint64_t required[COLS];
+    int columns = 0;
+    for (int c = 0; c < COLS; ++c) {
+        if (minRow[c] >= 0) required[columns++] = columnAbove(c, minRow[c]);
+    }
+
+    const GroupTable &table = groups();
+    GroupSet result;
+    for (int g = 0; g < table.count; ++g) {
+        if (!_threats[g]) continue;
+        bool all = true;
+        for (int i = 0; i < columns && all; ++i) {
+            all = (table.mask[g] & required[i]) != 0;
+        }
+        if (all) result.set(g);
+    }
+    return result;
+}
+
+void Connect4Knowledge::addSolution(uint64_t squares, uint64_t strict, uint64_t followUp, uint8_t inverseColumns, bool aftereven, const GroupSet &solves) {
+    if (solves.none() && !aftereven) return;
+    Solution s;
+    s.squares = squares;
+    s.strict = strict;
+    s.followUp = followUp;
+    s.inverseColumns = inverseColumns;
+    s.aftereven = aftereven;
+    s.solves = solves;
+    _solutions.push_back(s);
+}
+
+//
+// claimeven: the second player answers a move in the lower square by taking the even square above it
+//
+void Connect4Knowledge::findClaimevens() {
+    for (int c = 0; c < COLS; ++c) {
+        for (int r = _height[c]; r + 1 < ROWS; ++r) {
+            if (!isEvenRow(r + 1)) continue;
+            uint64_t upper = bit(square(c, r + 1));
+            addSolution(bit(square(c, r)) | upper, 0, 0, 0, false, groupsContaining(upper));
+        }
+    }
+}
+
+//
+// baseinverse: of two playable squares the first player can only get one
+//
+void Connect4Knowledge::findBaseinverses() {
+    for (size_t i = 0; i < _playable.size(); ++i) {
+        for (size_t j = i + 1; j < _playable.size(); ++j) {
+            uint64_t pair = bit(_playable[i]) | bit(_playable[j]);
+            addSolution(pair, pair, 0, 0, false, groupsContaining(pair));
+        }
+    }
+}
+
+//
+// vertical: of two stacked squares with an odd upper square the first player can only get one
+//
+void Connect4Knowledge::findVerticals() {
+    for (int c = 0; c < COLS; ++c) {
+        for (int r = _height[c]; r + 1 < ROWS; ++r) {
+            if (isEvenRow(r + 1)) continue;
+            uint64_t pair = bit(square(c, r)) | bit(square(c, r + 1));
+            addSolution(pair, pair, 0, 0, false, groupsContaining(pair));
+        }
+    }
+}
+
+//
+// aftereven: a second player group completed by claimevens alone, which refutes
+// every group that needs a square above it in each of its columns
+//
+void Connect4Knowledge::findAfterevens() {
+    const GroupTable &table = groups();
+    for (int g = 0; g < table.count; ++g) {
+        uint64_t m = table.mask[g];
+        if (m & _first) continue;
+
+        uint64_t squares = 0;
+        uint64_t followUp = 0;
+        int minRow[COLS];
+        std::fill(minRow, minRow + COLS, -1);
+        GroupSet solves;
+        bool valid = true;
+        for (int sq = 0; sq < COLS * ROWS && valid; ++sq) {
+            if (!(m & bit(sq)) || (_second & bit(sq))) continue;
+            int c = sq / ROWS;
+            int r = sq % ROWS;
+            if (!isEvenRow(r) || r - 1 < _height[c]) {
+                valid = false;
+                break;
+            }
+            squares |= bit(sq) | bit(sq - 1);
+            followUp |= columnAbove(c, r);
+            minRow[c] = r;
+            solves |= groupsContaining(bit(sq));
+        }
+        if (!valid || squares == 0) continue;
+
+        solves |= groupsAbove(minRow);
+        addSolution(squares, 0, followUp, 0, true, solves);
+    }
+}
+
+//
+// lowinverse and highinverse: pairs of columns where the first player can't get
+// the matching squares of both columns
+//
+void Connect4Knowledge::findInverses() {
+    for (int c1 = 0; c1 < COLS; ++c1) {
+        for (int c2 = c1 + 1; c2 < COLS; ++c2) {
+            uint8_t columns = (uint8_t)((1 << c1) | (1 << c2));
+
+            // lowinverse: two verticals, both upper squares odd
+            for (int r1 = _height[c1]; r1 + 1 < ROWS; ++r1) {
+                if (isEvenRow(r1 + 1)) continue;
+                for (int r2 = _height[c2]; r2 + 1 < ROWS; ++r2) {
+                    if (isEvenRow(r2 + 1)) continue;
+                    uint64_t l1 = bit(square(c1, r1)), u1 = bit(square(c1, r1 + 1));
+                    uint64_t l2 = bit(square(c2, r2)), u2 = bit(square(c2, r2 + 1));
+                    uint64_t squares = l1 | u1 | l2 | u2;
+                    GroupSet solves = groupsContaining(u1 | u2) | groupsContaining(l1 | u1) | groupsContaining(l2 | u2);
+                    addSolution(squares, squares, 0, columns, false, solves);
+                }
+            }
+
+            // highinverse: three stacked squares per column, both upper squares even
+            for (int r1 = _height[c1]; r1 + 2 < ROWS; ++r1) {
+                if (!isEvenRow(r1 + 2)) continue;
+                for (int r2 = _height[c2]; r2 + 2 < ROWS; ++r2) {
+                    if (!isEvenRow(r2 + 2)) continue;
+                    uint64_t l1 = bit(square(c1, r1)), m1 = bit(square(c1, r1 + 1)), u1 = bit(square(c1, r1 + 2));
+                    uint64_t l2 = bit(square(c2, r2)), m2 = bit(square(c2, r2 + 1)), u2 = bit(square(c2, r2 + 2));
+                    uint64_t squares = l1 | m1 | u1 | l2 | m2 | u2;
+                    GroupSet solves = groupsContaining(u1 | u2) | groupsContaining(m1 | m2) |
+                                      groupsContaining(l1 | m1) | groupsContaining(l2 | m2);
+                    if (r1 == _height[c1]) solves |= groupsContaining(l1 | u2);
+                    if (r2 == _height[c2]) solves |= groupsContaining(l2 | u1);
+                    addSolution(squares, squares, 0, columns, false, solves);
+                }
+            }
+        }
+    }
+}
+
+//
+// baseclaim: three playable squares where the second one has an even square above it
+//
+void Connect4Knowledge::findBaseclaims() {
+    for (int b : _playable) {
+        int row = b % ROWS;
+        if (row + 1 >= ROWS || !isEvenRow(row + 1)) continue;
+        uint64_t above = bit(b + 1);
+        for (int a : _playable) {
+            if (a == b) continue;
+            for (int c : _playable) {
+                if (c == a || c == b) continue;
+                uint64_t squares = bit(a) | bit(b) | above | bit(c);
+                GroupSet solves = groupsContaining(bit(a) | above) | groupsContaining(bit(b) | bit(c));
+                addSolution(squares, squares, 0, 0, false, solves);
+            }
+        }
+    }
+}
+
+//
+// before and specialbefore: a second player group whose empty squares are each
+// covered by a claimeven or vertical, refuting every group that needs all of
+// their successors
+//
+void Connect4Knowledge::findBefores() {
+    const GroupTable &table = groups();
+    for (int g = 0; g < table.count; ++g) {
+        uint64_t m = table.mask[g];
+        if (m & _first) continue;
+
+        int empties[4];
+        int emptyCount = 0;
+        uint8_t emptyColumns = 0;
+        bool valid = true;
+        for (int sq = 0; sq < COLS * ROWS && valid; ++sq) {
+            if (!(m & bit(sq)) || (_second & bit(sq))) continue;
+            int c = sq / ROWS;
+            if (sq % ROWS == ROWS - 1 || (emptyColumns & (1 << c))) valid = false;
+            emptyColumns |= (uint8_t)(1 << c);
+            empties[emptyCount++] = sq;
+        }
+        if (!valid || emptyCount == 0) continue;
+
+        uint64_t pairSquares[4];
+        GroupSet pairSolves[4];
+        uint64_t successors = 0;
+        for (int i = 0; i < emptyCount; ++i) {
+            int s = empties[i];
+            pairSquares[i] = bit(s) | bit(s + 1);
+            pairSolves[i] = isEvenRow(s % ROWS + 1) ? groupsContaining(bit(s + 1)) : groupsContaining(pairSquares[i]);
+            successors |= bit(s + 1);
+        }
+
+        uint64_t squares = 0;
+        GroupSet solves = groupsContaining(successors);
+        for (int i = 0; i < emptyCount; ++i) {
+            squares |= pairSquares[i];
+            solves |= pairSolves[i];
+        }
+        addSolution(squares, squares, 0, 0, false, solves);
+
+        // specialbefore: a playable empty square pairs with a playable square elsewhere instead
+        for (int i = 0; i < emptyCount; ++i) {
+            int p = empties[i];
+            if (p % ROWS != _height[p / ROWS]) continue;
+
+            uint64_t rest = 0;
+            GroupSet restSolves;
+            for (int j = 0; j < emptyCount; ++j) {
+                if (j == i) continue;
+                rest |= pairSquares[j];
+                restSolves |= pairSolves[j];
+            }
+            for (int q : _playable) {
+                if (emptyColumns & (1 << (q / ROWS))) continue;
+                if (rest & bit(q)) continue;
+                uint64_t special = rest | bit(p) | bit(q);
+                GroupSet specialSolves = restSolves | groupsContaining(successors | bit(q)) | groupsContaining(bit(p) | bit(q));
+                addSolution(special, special, 0, 0, false, specialSolves);
+            }
+        }
+    }
+}
+
+bool Connect4Knowledge::compatible(const Solution &s, const Usage &used) const {
+    return (s.squares & used.squares) == 0 &&
+           (s.followUp & used.strict) == 0 &&
+           (used.followUp & s.strict) == 0 &&
+           (s.inverseColumns & used.inverseColumns) == 0;
+}
+
+void Connect4Knowledge::use(const Solution &s, Usage &used) const {
+    used.squares |= s.squares;
+    used.strict |= s.strict;
+    used.followUp |= s.followUp;
+    used.inverseColumns |= s.inverseColumns;
+}
+
+//
+// depth first search for compatible solutions covering every threat,
+// always branching on the open group with the fewest candidates
+//
+bool Connect4Knowledge::cover(GroupSet covered, const Usage &used) {
+    if (++_nodes > _nodeLimit) return false;
+
+    GroupSet open = _threats & ~covered;
+    if (open.none()) return true;
+
+    int bestGroup = -1;
+    int bestCount = INT_MAX;
+    for (int g = 0; g < GROUP_COUNT; ++g) {
+        if (!open[g]) continue;
+        int count = 0;
+        for (int index : _byGroup[g]) {
+            if (compatible(_solutions[index], used)) ++count;
+        }
+        if (count == 0) return false;
+        if (count < bestCount) {
+            bestCount = count;
+            bestGroup = g;
+        }
+    }
+
+    for (int index : _byGroup[bestGroup]) {
+        const Solution &s = _solutions[index];
+        if (!compatible(s, used)) continue;
+        Usage next = used;
+        use(s, next);
+        if (cover(covered | s.solves, next)) return true;
+        if (_nodes > _nodeLimit) return false;
+    }
+    return false;
+}
+
+Connect4Knowledge::Result Connect4Knowledge::evaluate(const std::string &state) {
+    _nodes = 0;
+    _winFound = false;
+    _solutions.clear();
+    for (int g = 0; g < GROUP_COUNT; ++g) _byGroup[g].clear();
+
+    if (!loadState(state)) return Unknown;
+
+    findClaimevens();
+    findBaseinverses();
+    findVerticals();
+    findAfterevens();
+    findInverses();
+    findBaseclaims();
+    findBefores();
+
+    for (int i = 0; i < (int)_solutions.size(); ++i) {
+        for (int g = 0; g < GROUP_COUNT; ++g) {
+            if (_solutions[i].solves[g] && _threats[g]) _byGroup[g].push_back(i);
+        }
+    }
+
+    // an aftereven that fits alongside a full cover is completed by the end of the game
+    for (int i = 0; i < (int)_solutions.size() && !_winFound; ++i) {
+        const Solution &s = _solutions[i];
+        if (!s.aftereven) continue;
+        Usage used;
+        use(s, used);
+        _winFound = cover(s.solves, used);
+        if (_nodes > _nodeLimit) break;
+    }
+    if (_winFound) return SecondPlayerWins;
+
+    _nodes = 0;
+    if (cover(GroupSet(), Usage())) {
+        return SecondPlayerDraws;
+    }
+    return Unknown;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// rule based Connect 4 knowledge after Victor Allis' VICTOR program
+// with the first player to move, it tries to find a set of compatible rules
+// (claimeven, baseinverse, vertical, aftereven, lowinverse, highinverse,
+// baseclaim, before, specialbefore) that refutes every group the first player
+// could still complete. if it finds one, the second player can at least draw.
+//
+class Connect4Knowledge
+{
+public:
+    enum Result {
+        Unknown,            // nothing proven
+        SecondPlayerDraws,  // first player can't win
+        SecondPlayerWins    // first player can't win and the second completes an aftereven group
+    };
+
+    static const int COLS = 7;
+    static const int ROWS = 6;
+    static const int GROUP_COUNT = 69;
+
+    Connect4Knowledge() : _nodeLimit(20000), _nodes(0) {}
+
+    // state uses the Connect4 format: row-major from the top row, '0' empty,
+    // '1' first player, '2' second player
+    Result evaluate(const std::string &state);
+
+    // cap on the rule combination search, beyond which evaluate gives up
+    void setNodeLimit(int limit) { _nodeLimit = limit; }
+    int nodesSearched() const { return _nodes; }
+
+private:
+    typedef std::bitset<GROUP_COUNT> GroupSet;
+
+    struct Solution {
+        uint64_t squares;        // squares claimed by this rule
+        uint64_t strict;         // claimed squares no other rule may follow up through
+        uint64_t followUp;       // squares above an aftereven that must keep claimeven follow ups
+        uint8_t inverseColumns;  // columns taken by a lowinverse or highinverse
+        bool aftereven;
+        GroupSet solves;
+    };
+
+    struct Usage {
+        uint64_t squares = 0;
+        uint64_t strict = 0;
+        uint64_t followUp = 0;
+        uint8_t inverseColumns = 0;
+    };
+
+    // squares are numbered column * ROWS + row, with row 0 at the bottom
+    static int square(int col, int row) { return col * ROWS + row; }
+    static uint64_t bit(int sq) { return 1ULL << sq; }
+    // Allis counts rows from 1 at the bottom, so our even rows are his odd ones
+    static bool isEvenRow(int row) { return (row & 1) == 1; }
+
+    bool loadState(const std::string &state);
+    GroupSet groupsContaining(uint64_t mask) const;
+    GroupSet groupsAbove(const int minRow[COLS]) const;
+    void addSolution(uint64_t squares, uint64_t strict, uint64_t followUp, uint8_t inverseColumns, bool aftereven, const GroupSet &solves);
+
+    void findClaimevens();
+    void findBaseinverses();
+    void findVerticals();
+    void findAfterevens();
+    void findInverses();
+    void findBaseclaims();
+    void findBefores();
+
+    bool compatible(const Solution &s, const Usage &used) const;
+    void use(const Solution &s, Usage &used) const;
+    bool cover(GroupSet covered, const Usage &used);
+
+    uint64_t _first;
+    uint64_t _second;
+    int _height[COLS];
+    GroupSet _threats;
+    std::vector<Solution> _solutions;
+    std::vector<int> _byGroup[GROUP_COUNT];
+    std::vector<int> _playable;
+    int _nodeLimit;
+    int _nodes;
+    bool _winFound;
+};
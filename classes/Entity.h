@@ -14,6 +14,8 @@ public:
 
     Entity() : _entityType(EntityNone), _parent(nullptr), _retainCount(0) {};
     Entity(EntityType type) : _entityType(type) {};
+    // entities are deleted through base pointers (holders, cleanup), so the whole hierarchy is virtual
+    virtual ~Entity() {}
 
     EntityType getEntityType() {return _entityType; }
     
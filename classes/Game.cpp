@@ -2,7 +2,8 @@
 #include "Bit.h"
 #include "BitHolder.h"
 #include "Turn.h"
-#include "../Application.h"
+#include "ThreadPool.h"
+#include "PerfStats.h"
 
 Game::Game()
 {
@@ -16,10 +17,17 @@ Game::Game()
 	_gameOptions.score = 0;
 	_gameOptions.AIDepthSearches = 0;
 	_gameOptions.AIvsAI = false;
+	_gameOptions.AIPonder = true;
+	_gameOptions.AIFrameBudget = 0;
 
 	_table = nullptr;
 	_winner = nullptr;
 	_lastMove = "";
+	_gameOver = false;
+	_gameWinner = -1;
+	_mcts = nullptr;
+	_analyzer = nullptr;
+	_recordingMove = false;
 	// everything else
 	_dragBit = nullptr;
 	_dragMoved = false;
@@ -42,6 +50,11 @@ Game::~Game()
 		delete _player;
 	}
 	_players.clear();
+	stopPondering();
+	delete _mcts;
+	_mcts = nullptr;
+	delete _analyzer;
+	_analyzer = nullptr;
 
 	_gameOptions.score = 0;
 	_table = nullptr;
@@ -50,25 +63,40 @@ Game::~Game()
 	_lastMove = "";
 }
 
+//
+// called again on every reset, so the players already here are kept and
+// reset rather than leaked, and the old game's turns are given back
+//
 void Game::setNumberOfPlayers(unsigned int n)
 {
-	_players.clear();
+	while (_players.size() > n)
+	{
+		delete _players.back();
+		_players.pop_back();
+	}
+	while (_players.size() < n)
+	{
+		_players.push_back(Player::initWithGame(this));
+	}
 	for (unsigned int i = 1; i <= n; i++)
 	{
-		Player *player = Player::initWithGame(this);
+		Player *player = _players[i - 1];
 		//		player->setName( std::format( "Player-{}", i ) );
 		player->setName("Player");
 		player->setPlayerNumber(i - 1); // player numbers are zero-based
-		_players.push_back(player);
+		player->setAIPlayer(false);
 	}
 	_winner = nullptr;
 
 	_gameOptions.gameNumber = 0;
 	_gameOptions.numberOfPlayers = n;
 
-	Turn *turn = Turn::initStartOfGame(this);
+	for (auto &_turn : _turns)
+	{
+		delete _turn;
+	}
 	_turns.clear();
-	_turns.push_back(turn);
+	_turns.push_back(Turn::initStartOfGame(this));
 }
 
 void Game::setAIPlayer(unsigned int playerNumber)
@@ -85,19 +113,166 @@ void Game::startGame()
 	turn->_boardState = startState;
 	turn->_gameNumber = _gameOptions.gameNumber;
 	_gameOptions.currentTurnNo = 0;
+	_gameOver = false;
+	_gameWinner = -1;
+	clearMoveHistory();
 }
 
 void Game::endTurn()
 {
+	PerfStats::Scope timing(PerfStats::EndTurn);
 	_gameOptions.currentTurnNo++;
-	std::string startState = stateString();
+	recordTurn();
+	commitMove();
+	checkGameOver();
+}
+
+void Game::recordTurn()
+{
 	Turn *turn = new Turn;
 	turn->_boardState = stateString();
 	turn->_date = (int)_gameOptions.currentTurnNo;
 	turn->_score = _gameOptions.score;
 	turn->_gameNumber = _gameOptions.gameNumber;
 	_turns.push_back(turn);
-	ClassGame::EndOfTurn();
+}
+
+void Game::beginMove()
+{
+	_openMove.changes.clear();
+	_openMove.turnBefore = _gameOptions.currentTurnNo;
+	_openMove.extraBefore = moveExtra();
+	_recordingMove = true;
+}
+
+void Game::recordSquare(int index)
+{
+	if (_recordingMove)
+	{
+		recordSquare(index, squareState(index));
+	}
+}
+
+void Game::recordSquare(int index, char before)
+{
+	if (_recordingMove)
+	{
+		_openMove.changes.push_back({index, before, '0'});
+	}
+}
+
+void Game::commitMove()
+{
+	if (!_recordingMove)
+	{
+		return;
+	}
+	_recordingMove = false;
+	for (auto &change : _openMove.changes)
+	{
+		change.after = squareState(change.index);
+	}
+	_openMove.turnAfter = _gameOptions.currentTurnNo;
+	_openMove.extraAfter = moveExtra();
+	_undoMoves.push_back(std::move(_openMove));
+	_redoMoves.clear();
+}
+
+void Game::clearMoveHistory()
+{
+	_undoMoves.clear();
+	_redoMoves.clear();
+	_recordingMove = false;
+}
+
+//
+// take back the last move: put the squares it changed back the way they were
+//
+bool Game::undoMove()
+{
+	if (_undoMoves.empty())
+	{
+		return false;
+	}
+	stopPondering();
+	_looseBits.clear();
+	MoveDelta &move = _undoMoves.back();
+	for (auto change = move.changes.rbegin(); change != move.changes.rend(); ++change)
+	{
+		setSquareState(change->index, change->before);
+	}
+	setMoveExtra(move.extraBefore);
+	if (move.turnAfter != move.turnBefore && _turns.size() > 1)
+	{
+		delete _turns.back();
+		_turns.pop_back();
+	}
+	_gameOptions.currentTurnNo = move.turnBefore;
+	_gameOver = false;
+	_gameWinner = -1;
+	_redoMoves.push_back(std::move(move));
+	_undoMoves.pop_back();
+	return true;
+}
+
+//
+// play the last undone move again, the same way it was played the first time
+//
+bool Game::redoMove()
+{
+	if (_redoMoves.empty())
+	{
+		return false;
+	}
+	stopPondering();
+	_looseBits.clear();
+	MoveDelta &move = _redoMoves.back();
+	for (const auto &change : move.changes)
+	{
+		setSquareState(change.index, change.after);
+	}
+	setMoveExtra(move.extraAfter);
+	bool endedTurn = move.turnAfter != move.turnBefore;
+	_gameOptions.currentTurnNo = move.turnAfter;
+	if (endedTurn)
+	{
+		recordTurn();
+	}
+	_undoMoves.push_back(std::move(move));
+	_redoMoves.pop_back();
+	if (endedTurn)
+	{
+		checkGameOver();
+	}
+	return true;
+}
+
+//
+// after every turn: record a win or a draw and tell whoever is watching this game
+//
+void Game::checkGameOver()
+{
+	int result = lastMoveResult();
+	if (result == MCTSRules::Ongoing)
+	{
+		return;
+	}
+	_gameOver = true;
+	_gameWinner = result >= 0 ? result : -1;
+	if (_gameOverCallback)
+	{
+		_gameOverCallback(*this, _gameWinner);
+	}
+}
+
+int Game::lastMoveResult()
+{
+	if (checkForDraw())
+	{
+		return MCTSRules::Draw;
+	}
+	Player *winner = checkForWinner();
+	return winner ? winner->playerNumber() : MCTSRules::Ongoing;
 }
 
 //
@@ -108,6 +283,7 @@ void Game::endTurn()
 //
 void Game::scanForMouse()
 {
+	PerfStats::Scope timing(PerfStats::ScanForMouse);
 	if (gameHasAI() && getCurrentPlayer()->isAIPlayer())
 	{
 		return;
@@ -119,19 +295,21 @@ void Game::scanForMouse()
 	mousePos.x -= ImGui::GetWindowPos().x;
 	mousePos.y -= ImGui::GetWindowPos().y;
 
-	Entity *entity = nullptr;
-	Grid* grid = getGrid();
-	grid->forEachEnabledSquare([&](ChessSquare* square, int x, int y) {
+	// pieces in flight are drawn on top, then whatever sits on the square under the mouse
+	Entity *entity = _looseBits.spriteAt(mousePos);
+	ChessSquare *square = entity ? nullptr : getGrid()->getSquareAtPoint(mousePos);
+	if (square)
+	{
 		Bit *bit = square->bit();
-		if (bit && bit->isMouseOver(mousePos))
+		if (bit && !bit->getMoving() && !bit->getPickedUp() && bit->isMouseOver(mousePos))
 		{
 			entity = bit;
 		}
-		else if (square->isMouseOver(mousePos))
+		else
 		{
 			entity = square;
 		}
-	});
+	}
 	if (ImGui::IsMouseClicked(0))
 	{
 		mouseDown(mousePos, entity);
@@ -148,27 +326,22 @@ void Game::scanForMouse()
 
 void Game::findDropTarget(ImVec2 &pos)
 {
-	Grid* grid = getGrid();
-	grid->forEachEnabledSquare([&](ChessSquare* square, int x, int y) {
-		if (square == _oldHolder)
-		{
-			return;
-		}
-		if (square->isMouseOver(pos))
-		{
-			if (_dropTarget && square != _dropTarget)
-			{
-				_dropTarget->willNotDropBit(_dragBit);
-				_dropTarget->setHighlighted(false);
-				_dropTarget = nullptr;
-			}
-			if (_oldHolder && square->canDropBitAtPoint(_dragBit, pos) && canBitMoveFromTo(*_dragBit, *_oldHolder, *square))
-			{
-				_dropTarget = square;
-				_dropTarget->setHighlighted(true);
-			}
-		}
-	});
+	ChessSquare *square = getGrid()->getSquareAtPoint(pos);
+	if (!square || square == _oldHolder)
+	{
+		return;
+	}
+	if (_dropTarget && square != _dropTarget)
+	{
+		_dropTarget->willNotDropBit(_dragBit);
+		_dropTarget->setHighlighted(false);
+		_dropTarget = nullptr;
+	}
+	if (_oldHolder && square->canDropBitAtPoint(_dragBit, pos) && canBitMoveFromTo(*_dragBit, *_oldHolder, *square))
+	{
+		_dropTarget = square;
+		_dropTarget->setHighlighted(true);
+	}
 }
 
 //
@@ -177,38 +350,52 @@ void Game::findDropTarget(ImVec2 &pos)
 //
 void Game::drawFrame()
 {
-	scanForMouse();
-
+	// the board's sprites are contiguous columns in the store, so each layer is a linear sweep
+	// only the running tweens get advanced, idle pieces cost nothing
 	Grid* grid = getGrid();
+	SpriteStore &sprites = SpriteStore::local();
+	int group = grid->getSpriteGroup();
+	sprites.advance();
 
-	// Paint squares
-	grid->forEachEnabledSquare([](ChessSquare* square, int x, int y) {
-		square->paintSprite();
-	});
+	// find the pieces off the lattice before the mouse is looked at, the last frame's
+	// may have been freed since (captured, undone or the game stopped)
+	collectLooseBits();
+	scanForMouse();
 
-	// Paint stationary pieces
-	grid->forEachEnabledSquare([](ChessSquare* square, int x, int y) {
-		if (square->bit() && !square->bit()->getPickedUp() && !square->bit()->getMoving())
-		{
-			square->bit()->paintSprite();
-		}
+	// Paint squares, from the baked board unless they changed
+	_background.paint(sprites, group);
+
+	// Paint stationary pieces, some may be turning over in place
+	sprites.forEach(group, SpriteStore::Piece | SpriteStore::Moving | SpriteStore::PickedUp, SpriteStore::Piece, [&sprites](SpriteStore::Handle handle) {
+		sprites.paint(handle);
 	});
 
 	// Paint moving pieces
-	grid->forEachEnabledSquare([](ChessSquare* square, int x, int y) {
-		if (square->bit() && square->bit()->getMoving() && !square->bit()->getPickedUp())
-		{
-			square->bit()->update();
-			square->bit()->paintSprite();
-		}
+	sprites.forEach(group, SpriteStore::Piece | SpriteStore::Moving | SpriteStore::PickedUp, SpriteStore::Piece | SpriteStore::Moving, [&sprites](SpriteStore::Handle handle) {
+		sprites.paint(handle);
 	});
 
 	// Paint picked up pieces
-	grid->forEachEnabledSquare([](ChessSquare* square, int x, int y) {
-		if (square->bit() && square->bit()->getPickedUp())
-		{
-			square->bit()->paintSprite();
-		}
+	sprites.forEach(group, SpriteStore::Piece | SpriteStore::PickedUp, SpriteStore::Piece | SpriteStore::PickedUp, [&sprites](SpriteStore::Handle handle) {
+		sprites.paint(handle);
+	});
+}
+
+//
+// moving pieces, then picked up ones, in the order they're painted so the topmost wins
+//
+void Game::collectLooseBits()
+{
+	Grid* grid = getGrid();
+	SpriteStore &sprites = SpriteStore::local();
+	int group = grid->getSpriteGroup();
+	_looseBits.setCellSize(grid->getSquareSize());
+	_looseBits.clear();
+	sprites.forEach(group, SpriteStore::Piece | SpriteStore::Moving | SpriteStore::PickedUp, SpriteStore::Piece | SpriteStore::Moving, [this, &sprites](SpriteStore::Handle handle) {
+		_looseBits.insert(sprites.owners[handle]);
+	});
+	sprites.forEach(group, SpriteStore::Piece | SpriteStore::PickedUp, SpriteStore::Piece | SpriteStore::PickedUp, [this, &sprites](SpriteStore::Handle handle) {
+		_looseBits.insert(sprites.owners[handle]);
 	});
 }
 
@@ -242,8 +429,137 @@ bool Game::gameHasAI()
 	return false;
 }
 
+//
+// games with search rules are played by MCTS unless they override this
+//
 void Game::updateAI()
 {
+	MCTSRules *rules = searchRules();
+	if (!rules)
+	{
+		return;
+	}
+	if (!_mcts)
+	{
+		_mcts = new MCTS(*rules);
+	}
+	int move;
+	if (_gameOptions.AIFrameBudget > 0)
+	{
+		// no thread to search on, so search for a slice of this frame and pick up
+		// where it left off on the next one. only the ponder search shares the tree,
+		// the analyser is left alone rather than restarted every frame
+		stopPonderSearch();
+		stopSearch(_aiSearch);
+		std::string state = searchState();
+		if (state != _slicedState)
+		{
+			// setting up (or first allocating) the tree is a frame's work on its own
+			_mcts->begin(state);
+			_slicedState = state;
+			return;
+		}
+		if (!_mcts->step(_gameOptions.AIFrameBudget))
+		{
+			return;
+		}
+		_slicedState.clear();
+		move = _mcts->bestMove();
+	}
+	else
+	{
+		// search on the pool and look in on it each frame, the frame never waits for it
+		std::string state = searchState();
+		if (!_aiSearch.valid() || state != _aiState)
+		{
+			// a ponder hit leaves the reply already in the tree, and search reuses it
+			stopPondering();
+			_slicedState.clear();
+			_aiState = state;
+			MCTS *mcts = _mcts;
+			_aiSearch = ThreadPool::instance().submit([mcts, state]() { return mcts->search(state); });
+			return;
+		}
+		if (_aiSearch.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return;
+		}
+		move = _aiSearch.get();
+	}
+	if (move != MCTS::NoMove)
+	{
+		applySearchMove(move);
+	}
+}
+
+//
+// by default pondering grows the MCTS tree from the human's position, so whatever
+// they play the AI's next search starts from a warm subtree
+//
+void Game::ponder()
+{
+	MCTSRules *rules = searchRules();
+	// pondering needs a thread of its own
+	if (!rules || !_gameOptions.AIPonder || _gameOptions.AIFrameBudget > 0)
+	{
+		return;
+	}
+	std::string state = searchState();
+	if (_ponderSearch.valid() && state == _ponderState)
+	{
+		return;
+	}
+	stopPondering();
+	if (!_mcts)
+	{
+		_mcts = new MCTS(*rules);
+	}
+	_ponderState = state;
+	MCTS *mcts = _mcts;
+	_ponderSearch = ThreadPool::instance().submit([mcts, state]() { return mcts->search(state, true); });
+}
+
+void Game::stopPondering()
+{
+	if (_analyzer)
+	{
+		_analyzer->stop();
+	}
+	stopPonderSearch();
+	stopSearch(_aiSearch);
+}
+
+void Game::stopPonderSearch()
+{
+	stopSearch(_ponderSearch);
+}
+
+void Game::stopSearch(std::future<int> &search)
+{
+	if (!search.valid())
+	{
+		return;
+	}
+	// keep asking, the search may not have started (and reset its stop flag) yet
+	while (search.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+	{
+		_mcts->stop();
+	}
+	search.get();
+}
+
+Analyzer *Game::analyzer()
+{
+	MCTSRules *rules = searchRules();
+	if (!rules)
+	{
+		return nullptr;
+	}
+	if (!_analyzer)
+	{
+		_analyzer = new Analyzer(*rules);
+	}
+	return _analyzer;
 }
 
 void Game::mouseDown(ImVec2 &location, Entity *entity)
@@ -12,6 +12,7 @@
 #include <chrono>
 #include <ctime>
 #include <future>
+#include <functional>
 
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -22,6 +23,10 @@
 #include "Bit.h"
 #include "BitHolder.h"
 #include "Grid.h"
+#include "SpatialHash.h"
+#include "BoardBackground.h"
+#include "MCTS.h"
+#include "Analyzer.h"
 
 
 const int AI_PLAYER = 1;
@@ -42,13 +47,18 @@ struct GameOptions
 	int AIDepthSearches;
 	int AIMAXDepth;
 	bool AIvsAI;
+	bool AIPonder;
+	// microseconds of AI search per frame on the main thread, for builds without
+	// threads; the search resumes each frame until done. 0 searches on the pool
+	int AIFrameBudget;
 };
 
 class Game
 {
 public:
 	Game();
-	~Game();
+	// games are deleted through Game pointers, each must stop its own background work first
+	virtual ~Game();
 
 	void startGame();
 
@@ -90,17 +100,49 @@ public:
 
 	virtual Player *checkForWinner() = 0;
 	virtual bool checkForDraw() = 0;
+	// did the move just played end the game? returns the winning player number, or
+	// MCTSRules::Draw or MCTSRules::Ongoing. games override it to judge from the
+	// last move alone; the default asks checkForWinner and checkForDraw
+	virtual int lastMoveResult();
 	virtual bool animateAndPlaceBitFromTo(Bit &bit, BitHolder &src, BitHolder &dst);
 
 	virtual void stopGame() = 0;
 	virtual bool gameHasAI();
 	virtual void updateAI();
+	// think on the opponent's time, called every frame while a human is to move
+	virtual void ponder();
+	// stop any background thinking (pondering and analysis) and wait for it to wind down
+	virtual void stopPondering();
 	virtual void pieceTaken(Bit *bit){};
 
 	virtual std::string initialStateString() = 0;
 	virtual std::string stateString() = 0;
 	virtual void setStateString(const std::string &s) = 0;
 
+	// search support: a game that describes its rules gets an MCTS player from the default updateAI
+	virtual MCTSRules *searchRules() { return nullptr; }
+	// the position handed to the rules, by default the state string
+	virtual std::string searchState() { return stateString(); }
+	// play a move chosen by the search on the real board
+	virtual void applySearchMove(int move) {}
+	// background analysis of the current position, nullptr for games without search rules
+	Analyzer *analyzer();
+
+	// game over notification goes to each game's own callback rather than any global
+	// state, so any number of games can run side by side (e.g. batch simulations)
+	// the callback gets the winning player number, or -1 for a draw
+	typedef std::function<void(Game &game, int winner)> GameOverCallback;
+	void setGameOverCallback(GameOverCallback callback) { _gameOverCallback = callback; }
+	bool isGameOver() const { return _gameOver; }
+	int gameWinner() const { return _gameWinner; }
+
+	// takeback: every move keeps a small delta of the squares it changed, so
+	// undoing or redoing it touches only those squares, never the whole board
+	bool canUndo() const { return !_undoMoves.empty(); }
+	bool canRedo() const { return !_redoMoves.empty(); }
+	bool undoMove();
+	bool redoMove();
+
 	void setNumberOfPlayers(unsigned int playerCount);
 	void setAIPlayer(unsigned int playerNumber);
 	virtual int getAIDepathSearches() { return _gameOptions.AIDepthSearches; };
@@ -138,6 +180,68 @@ public:
 	GameOptions _gameOptions;
 
 protected:
+	void checkGameOver();
+	// stopGame frees the pieces, so it forgets the ones last seen off the board too
+	void forgetLooseBits() { _looseBits.clear(); }
+
+	// what one move did: the squares it changed (placed, flipped, captured or
+	// promoted pieces) with their piece codes before and after, the turn number
+	// and the game's own bookkeeping that isn't on the board
+	struct MoveDelta
+	{
+		struct Change
+		{
+			int index;
+			char before;
+			char after;
+		};
+		std::vector<Change> changes;
+		unsigned int turnBefore;
+		unsigned int turnAfter;
+		int extraBefore;
+		int extraAfter;
+	};
+
+	// games bracket each move with these and record every square before they change it
+	// endTurn commits the open move, a move that doesn't end the turn commits itself
+	void beginMove();
+	void recordSquare(int index);
+	// for a square that already changed before the game heard about it (a dragged piece)
+	void recordSquare(int index, char before);
+	void commitMove();
+	void clearMoveHistory();
+	void recordTurn();
+
+	// the piece code on a grid index, and putting one there, is all undo and redo need
+	// from a game, plus whatever state it keeps off the board (passes, last move, ...)
+	virtual char squareState(int index) { return '0'; }
+	virtual void setSquareState(int index, char state) {}
+	virtual int moveExtra() { return 0; }
+	virtual void setMoveExtra(int extra) {}
+
+	std::vector<MoveDelta> _undoMoves;
+	std::vector<MoveDelta> _redoMoves;
+	MoveDelta _openMove;
+	bool _recordingMove;
+
+	bool _gameOver;
+	int _gameWinner;
+	GameOverCallback _gameOverCallback;
+
+	MCTS *_mcts;
+	Analyzer *_analyzer;
+	std::future<int> _ponderSearch;
+	std::string _ponderState;
+	// the AI's own move search when it runs on the pool, and the position it's for
+	std::future<int> _aiSearch;
+	std::string _aiState;
+	// stop just the MCTS ponder search, leaving the analyser running
+	void stopPonderSearch();
+	void stopSearch(std::future<int> &search);
+	// the position a frame sliced search is working on, empty when none is
+	std::string _slicedState;
+
+	void collectLooseBits();
 	void mouseDown(ImVec2 &location, Entity *bit);
 	void mouseMoved(ImVec2 &location, Entity *bit);
 	void mouseUp(ImVec2 &location, Entity *bit);
@@ -151,4 +255,8 @@ protected:
 	BitHolder *_dropTarget;
 	BitHolder *_oldHolder;
 	bool _dragMoved;
+	// pieces off the board lattice (moving or picked up) as of the last frame
+	SpatialHash _looseBits;
+	// the squares, baked into one texture while they don't change
+	BoardBackground _background;
 };
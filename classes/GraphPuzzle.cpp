@@ -0,0 +1,196 @@
+#include "GraphPuzzle.h"
+
+#include <algorithm>
+#include <bit>
+#include <deque>
+
+GraphPuzzle::GraphPuzzle(Grid &grid) : _grid(grid), _playerStart(-1), _exit(-1), _playerBits(0), _exitNode(-1)
+{
+}
+
+void GraphPuzzle::addPatrol(const std::vector<int> &route)
+{
+    if (!route.empty()) _routes.push_back(route);
+}
+
+void GraphPuzzle::addChaser(int gridIndex)
+{
+    _chaserStarts.push_back(gridIndex);
+}
+
+int GraphPuzzle::nodeOf(int gridIndex)
+{
+    if (_nodeId[gridIndex] < 0) {
+        _nodeId[gridIndex] = (int)_gridIndex.size();
+        _gridIndex.push_back(gridIndex);
+    }
+    return _nodeId[gridIndex];
+}
+
+//
+// breadth first distances from every node to the target, walking the edges backwards
+//
+static void distancesTo(int target, const std::vector<std::vector<int>> &incoming, std::vector<int> &distance)
+{
+    distance.assign(incoming.size(), -1);
+    std::deque<int> queue;
+    distance[target] = 0;
+    queue.push_back(target);
+    while (!queue.empty()) {
+        int node = queue.front();
+        queue.pop_front();
+        for (int from : incoming[node]) {
+            if (distance[from] < 0) {
+                distance[from] = distance[node] + 1;
+                queue.push_back(from);
+            }
+        }
+    }
+}
+
+bool GraphPuzzle::prepare()
+{
+    int squares = _grid.getWidth() * _grid.getHeight();
+    auto onBoard = [squares](int index) { return index >= 0 && index < squares; };
+    if (!onBoard(_playerStart) || !onBoard(_exit)) return false;
+    for (const auto &route : _routes) {
+        for (int index : route) {
+            if (!onBoard(index)) return false;
+        }
+    }
+    for (int index : _chaserStarts) {
+        if (!onBoard(index)) return false;
+    }
+
+    // number only the squares the puzzle can touch, so the state packs tighter
+    _nodeId.assign(squares, -1);
+    _gridIndex.clear();
+    nodeOf(_playerStart);
+    _exitNode = nodeOf(_exit);
+    for (int i = 0; i < squares; i++) {
+        for (int to : _grid.getConnectedIndices(i)) {
+            nodeOf(i);
+            nodeOf(to);
+        }
+    }
+    for (const auto &route : _routes) {
+        for (int index : route) nodeOf(index);
+    }
+    for (int index : _chaserStarts) nodeOf(index);
+
+    int count = (int)_gridIndex.size();
+    std::vector<std::vector<int>> incoming(count);
+    _rowStart.assign(count + 1, 0);
+    _neighbors.clear();
+    for (int node = 0; node < count; node++) {
+        for (int to : _grid.getConnectedIndices(_gridIndex[node])) {
+            _neighbors.push_back(_nodeId[to]);
+            incoming[_nodeId[to]].push_back(node);
+        }
+        _rowStart[node + 1] = (int)_neighbors.size();
+    }
+
+    // lay out the state: the player in the low bits, then each enemy
+    _playerBits = std::max(1, (int)std::bit_width((unsigned int)(count - 1)));
+    int shift = _playerBits;
+    _enemies.clear();
+    for (int index : _chaserStarts) {
+        Enemy enemy;
+        enemy.chaser = true;
+        enemy.start = _nodeId[index];
+        enemy.captured = (uint64_t)count;
+        enemy.bits = (int)std::bit_width((unsigned int)count);
+        enemy.shift = shift;
+        shift += enemy.bits;
+        _enemies.push_back(enemy);
+    }
+    for (const auto &route : _routes) {
+        Enemy enemy;
+        enemy.chaser = false;
+        enemy.start = _nodeId[route[0]];
+        for (int index : route) enemy.cycle.push_back(_nodeId[index]);
+        if (route.size() > 2 && route.front() == route.back()) {
+            enemy.cycle.pop_back();
+        } else {
+            for (int i = (int)route.size() - 2; i > 0; i--) enemy.cycle.push_back(_nodeId[route[i]]);
+        }
+        enemy.captured = (uint64_t)enemy.cycle.size();
+        enemy.bits = (int)std::bit_width((unsigned int)enemy.cycle.size());
+        enemy.shift = shift;
+        shift += enemy.bits;
+        _enemies.push_back(enemy);
+    }
+    if (shift > 64) return false;
+
+    std::vector<int> distance;
+    distancesTo(_exitNode, incoming, _exitDistance);
+    _nextStep.clear();
+    if (!_chaserStarts.empty()) {
+        // a chaser steps to the neighbor closest to its target, or stays put if none is closer
+        _nextStep.assign((size_t)count * count, 0);
+        for (int target = 0; target < count; target++) {
+            distancesTo(target, incoming, distance);
+            for (int node = 0; node < count; node++) {
+                int best = node;
+                for (int i = _rowStart[node]; i < _rowStart[node + 1]; i++) {
+                    int to = _neighbors[i];
+                    if (distance[to] >= 0 && (distance[best] < 0 || distance[to] < distance[best])) best = to;
+                }
+                _nextStep[(size_t)node * count + target] = best;
+            }
+        }
+    }
+    return true;
+}
+
+int GraphPuzzle::enemyNode(const Enemy &enemy, uint64_t slot) const
+{
+    return enemy.chaser ? (int)slot : enemy.cycle[slot];
+}
+
+uint64_t GraphPuzzle::initialState() const
+{
+    uint64_t state = (uint64_t)_nodeId[_playerStart];
+    for (const Enemy &enemy : _enemies) {
+        uint64_t slot = enemy.chaser ? (uint64_t)enemy.start : 0;
+        state |= slot << enemy.shift;
+    }
+    return state;
+}
+
+void GraphPuzzle::successors(uint64_t state, std::vector<std::pair<int, uint64_t>> &next) const
+{
+    int count = (int)_gridIndex.size();
+    int player = (int)(state & ((1ULL << _playerBits) - 1));
+    for (int i = _rowStart[player]; i < _rowStart[player + 1]; i++) {
+        int to = _neighbors[i];
+        uint64_t moved = (uint64_t)to;
+        bool lost = false;
+        for (const Enemy &enemy : _enemies) {
+            uint64_t slot = (state >> enemy.shift) & ((1ULL << enemy.bits) - 1);
+            if (slot != enemy.captured) {
+                int node = enemyNode(enemy, slot);
+                if (node == to) {
+                    slot = enemy.captured;
+                } else if (to != _exitNode) {
+                    // reaching the exit ends the puzzle before the enemies move
+                    slot = enemy.chaser ? (uint64_t)_nextStep[(size_t)node * count + to] : (slot + 1) % enemy.cycle.size();
+                    lost |= enemyNode(enemy, slot) == to;
+                }
+            }
+            moved |= slot << enemy.shift;
+        }
+        if (!lost) next.emplace_back(_gridIndex[to], moved);
+    }
+}
+
+bool GraphPuzzle::isGoal(uint64_t state) const
+{
+    return (int)(state & ((1ULL << _playerBits) - 1)) == _exitNode;
+}
+
+int GraphPuzzle::heuristic(uint64_t state) const
+{
+    int distance = _exitDistance[state & ((1ULL << _playerBits) - 1)];
+    return distance >= 0 ? distance : (int)_gridIndex.size();
+}
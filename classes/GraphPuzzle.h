@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Grid.h"
+#include "PuzzleSolver.h"
+
+#include <vector>
+
+//
+// a Hitman Go style puzzle on a Grid's connection graph
+// the player moves one connection a turn toward the exit. moving onto an enemy
+// takes it, then every enemy left moves: patrols step along their route and
+// chasers take a shortest path step toward the player. ending up on the same
+// node as an enemy loses. moves are the grid index the player moves to.
+//
+// the whole position (player node, each chaser's node, each patrol's place
+// on its route, captured enemies) is packed into a 64 bit state
+//
+class GraphPuzzle : public PuzzleRules
+{
+public:
+    explicit GraphPuzzle(Grid &grid);
+
+    // board setup, in grid indices
+    void setPlayer(int gridIndex) { _playerStart = gridIndex; }
+    void setExit(int gridIndex) { _exit = gridIndex; }
+    // walks the route back and forth, or round and round if it ends where it starts
+    void addPatrol(const std::vector<int> &route);
+    void addChaser(int gridIndex);
+
+    // build the node numbering, distance tables and state layout once the board is set up
+    // returns false if the puzzle doesn't fit a 64 bit state
+    bool prepare();
+
+    uint64_t initialState() const override;
+    void successors(uint64_t state, std::vector<std::pair<int, uint64_t>> &next) const override;
+    bool isGoal(uint64_t state) const override;
+    int heuristic(uint64_t state) const override;
+
+private:
+    struct Enemy {
+        bool chaser;
+        int start;                  // starting node id of a chaser
+        std::vector<int> cycle;     // node ids a patrol visits, in order
+        int shift;                  // where the enemy sits in the packed state
+        int bits;
+        uint64_t captured;          // the slot value of a taken enemy
+    };
+
+    int nodeOf(int gridIndex);
+    int enemyNode(const Enemy &enemy, uint64_t slot) const;
+
+    Grid &_grid;
+    int _playerStart;
+    int _exit;
+    std::vector<Enemy> _enemies;
+    std::vector<std::vector<int>> _routes;      // patrol routes, in grid indices
+    std::vector<int> _chaserStarts;
+
+    // the graph over compact node ids, only squares the puzzle uses get one
+    std::vector<int> _nodeId;                   // grid index -> node id, or -1
+    std::vector<int> _gridIndex;                // node id -> grid index
+    std::vector<int> _rowStart;
+    std::vector<int> _neighbors;
+    std::vector<int> _exitDistance;
+    std::vector<int> _nextStep;                 // [node * count + target] chaser step toward target
+    int _playerBits;
+    int _exitNode;
+};
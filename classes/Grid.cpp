@@ -1,42 +1,40 @@
 #include "Grid.h"
+#include <algorithm>
+#include <cmath>
 
-Grid::Grid(int width, int height) : _width(width), _height(height)
+Grid::Grid(int width, int height) : _frozen(true), _squareSize(0.0f), _width(width), _height(height)
 {
-    // Initialize 2D vectors
-    _squares.resize(height);
-    _enabled.resize(height);
+    int count = width * height;
+    _squares.reset(new ChessSquare[count]);
 
-    for (int y = 0; y < height; y++) {
-        _squares[y].resize(width);
-        _enabled[y].resize(width);
+    // All squares enabled by default
+    _enabled.assign((count + 63) / 64, ~0ULL);
+    if (count % 64) {
+        _enabled.back() = (1ULL << (count % 64)) - 1;
+    }
+    _rowStart.assign(count + 1, 0);
 
-        for (int x = 0; x < width; x++) {
-            _squares[y][x] = new ChessSquare();
-            _enabled[y][x] = true; // All squares enabled by default
-        }
+    // the board's squares and pieces are drawn together as one sprite group
+    _spriteGroup = SpriteStore::newGroup();
+    for (int index = 0; index < count; index++) {
+        _squares[index].setGroup(_spriteGroup);
     }
 }
 
 Grid::~Grid()
 {
-    for (int y = 0; y < _height; y++) {
-        for (int x = 0; x < _width; x++) {
-            delete _squares[y][x];
-        }
-    }
 }
 
 ChessSquare* Grid::getSquare(int x, int y)
 {
     if (!isValid(x, y)) return nullptr;
-    return _squares[y][x];
+    return &_squares[getIndex(x, y)];
 }
 
 ChessSquare* Grid::getSquareByIndex(int index)
 {
-    int x, y;
-    getCoordinates(index, x, y);
-    return getSquare(x, y);
+    if (index < 0 || index >= _width * _height) return nullptr;
+    return &_squares[index];
 }
 
 bool Grid::isValid(int x, int y) const
@@ -47,13 +45,19 @@ bool Grid::isValid(int x, int y) const
 bool Grid::isEnabled(int x, int y) const
 {
     if (!isValid(x, y)) return false;
-    return _enabled[y][x];
+    return enabledAt(getIndex(x, y));
 }
 
 void Grid::setEnabled(int x, int y, bool enabled)
 {
     if (isValid(x, y)) {
-        _enabled[y][x] = enabled;
+        int index = getIndex(x, y);
+        if (enabled) {
+            _enabled[index >> 6] |= 1ULL << (index & 63);
+        } else {
+            _enabled[index >> 6] &= ~(1ULL << (index & 63));
+        }
+        _squares[index].setVisible(enabled);
     }
 }
 
@@ -109,65 +113,86 @@ ChessSquare* Grid::getW(int x, int y)
 }
 
 // Graph connections
+// the bit matrix costs count^2 bits, so past this many squares areConnected
+// falls back to a binary search of the sorted CSR row
+static const int kMaxAdjacencySquares = 4096;
+
 void Grid::addConnection(int fromIndex, int toIndex)
 {
-    _connections[fromIndex].push_back(toIndex);
+    int count = _width * _height;
+    if (fromIndex < 0 || fromIndex >= count || toIndex < 0 || toIndex >= count) return;
+    _edges.emplace_back(fromIndex, toIndex);
+    _frozen = false;
 }
 
 void Grid::addConnection(int fromX, int fromY, int toX, int toY)
 {
+    if (!isValid(fromX, fromY) || !isValid(toX, toY)) return;
     addConnection(getIndex(fromX, fromY), getIndex(toX, toY));
 }
 
-std::vector<ChessSquare*> Grid::getConnectedSquares(int x, int y)
+void Grid::freezeConnections()
 {
-    std::vector<ChessSquare*> connected;
-    int index = getIndex(x, y);
+    if (_frozen) return;
+    int count = _width * _height;
 
-    if (_connections.find(index) != _connections.end()) {
-        for (int connectedIndex : _connections[index]) {
-            ChessSquare* square = getSquareByIndex(connectedIndex);
-            if (square) {
-                connected.push_back(square);
-            }
-        }
+    std::sort(_edges.begin(), _edges.end());
+    _edges.erase(std::unique(_edges.begin(), _edges.end()), _edges.end());
+
+    _rowStart.assign(count + 1, 0);
+    for (const auto& edge : _edges) {
+        _rowStart[edge.first + 1]++;
+    }
+    for (int i = 0; i < count; i++) {
+        _rowStart[i + 1] += _rowStart[i];
+    }
+    // the edges are sorted, so each row comes out sorted too
+    _neighbors.resize(_edges.size());
+    for (size_t i = 0; i < _edges.size(); i++) {
+        _neighbors[i] = _edges[i].second;
     }
 
-    return connected;
+    _adjacency.clear();
+    if (count <= kMaxAdjacencySquares) {
+        _adjacency.assign(((size_t)count * count + 63) / 64, 0);
+        for (const auto& edge : _edges) {
+            size_t bit = (size_t)edge.first * count + edge.second;
+            _adjacency[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+    _frozen = true;
 }
 
-bool Grid::areConnected(int fromX, int fromY, int toX, int toY)
+Grid::SquareRange Grid::getConnectedSquares(int x, int y)
 {
-    int fromIndex = getIndex(fromX, fromY);
-    int toIndex = getIndex(toX, toY);
-
-    if (_connections.find(fromIndex) != _connections.end()) {
-        const auto& connections = _connections[fromIndex];
-        return std::find(connections.begin(), connections.end(), toIndex) != connections.end();
-    }
+    if (!isValid(x, y)) return SquareRange(std::span<const int>(), _squares.get());
+    return SquareRange(getConnectedIndices(getIndex(x, y)), _squares.get());
+}
 
-    return false;
+std::span<const int> Grid::getConnectedIndices(int index)
+{
+    freezeConnections();
+    if (index < 0 || index >= _width * _height) return std::span<const int>();
+    return std::span<const int>(_neighbors.data() + _rowStart[index], _rowStart[index + 1] - _rowStart[index]);
 }
 
-// Iterator support
-void Grid::forEachSquare(std::function<void(ChessSquare*, int x, int y)> func)
+bool Grid::areConnected(int fromX, int fromY, int toX, int toY)
 {
-    for (int y = 0; y < _height; y++) {
-        for (int x = 0; x < _width; x++) {
-            func(_squares[y][x], x, y);
-        }
-    }
+    if (!isValid(fromX, fromY) || !isValid(toX, toY)) return false;
+    return areConnected(getIndex(fromX, fromY), getIndex(toX, toY));
 }
 
-void Grid::forEachEnabledSquare(std::function<void(ChessSquare*, int x, int y)> func)
+bool Grid::areConnected(int fromIndex, int toIndex)
 {
-    for (int y = 0; y < _height; y++) {
-        for (int x = 0; x < _width; x++) {
-            if (_enabled[y][x]) {
-                func(_squares[y][x], x, y);
-            }
-        }
+    freezeConnections();
+    int count = _width * _height;
+    if (fromIndex < 0 || fromIndex >= count || toIndex < 0 || toIndex >= count) return false;
+    if (!_adjacency.empty()) {
+        size_t bit = (size_t)fromIndex * count + toIndex;
+        return (_adjacency[bit >> 6] >> (bit & 63)) & 1;
     }
+    std::span<const int> row = getConnectedIndices(fromIndex);
+    return std::binary_search(row.begin(), row.end(), toIndex);
 }
 
 // Initialize squares
@@ -183,25 +208,37 @@ void Grid::initializeSquares(float squareSize, const char* spriteName)
 void Grid::initializeSquare(int x, int y, float squareSize, const char* spriteName)
 {
     if (isValid(x, y)) {
+        _squareSize = squareSize;
         ImVec2 position(squareSize * x + squareSize/2, squareSize * y + squareSize/2);
-        _squares[y][x]->initHolder(position, spriteName, x, y);
+        _squares[getIndex(x, y)].initHolder(position, spriteName, x, y);
     }
 }
 
+// Hit testing
+ChessSquare* Grid::getSquareAtPoint(const ImVec2& point)
+{
+    if (_squareSize <= 0.0f) return nullptr;
+    // square (x, y) starts half a square in, see initializeSquare
+    int x = (int)std::floor(point.x / _squareSize - 0.5f);
+    int y = (int)std::floor(point.y / _squareSize - 0.5f);
+    if (!isEnabled(x, y)) return nullptr;
+    ChessSquare* square = &_squares[getIndex(x, y)];
+    return square->isMouseOver(point) ? square : nullptr;
+}
+
 // State management
 std::string Grid::getStateString() const
 {
     std::string state;
-
-    for (int y = 0; y < _height; y++) {
-        for (int x = 0; x < _width; x++) {
-            if (_enabled[y][x]) {
-                Bit* bit = _squares[y][x]->bit();
-                if (bit) {
-                    state += std::to_string(bit->gameTag());
-                } else {
-                    state += '0';
-                }
+    state.reserve(_width * _height);
+
+    for (int index = 0; index < _width * _height; index++) {
+        if (enabledAt(index)) {
+            Bit* bit = _squares[index].bit();
+            if (bit) {
+                state += std::to_string(bit->gameTag());
+            } else {
+                state += '0';
             }
         }
     }
@@ -215,11 +252,11 @@ void Grid::setStateString(const std::string& state)
 
     for (int y = 0; y < _height && index < state.length(); y++) {
         for (int x = 0; x < _width && index < state.length(); x++) {
-            if (_enabled[y][x]) {
+            if (enabledAt(getIndex(x, y))) {
                 char pieceChar = state[index++];
 
                 // Clear existing piece
-                _squares[y][x]->destroyBit();
+                _squares[getIndex(x, y)].destroyBit();
 
                 // This method just sets the state - games need to create their own pieces
                 // when loading from state string based on the piece type
@@ -1,14 +1,49 @@
 #pragma once
 
 #include "ChessSquare.h"
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
-#include <unordered_map>
-#include <functional>
 #include <string>
 
+//
+// a width x height board of squares
+// the squares live in one row-major array and the enabled flags in a bit mask,
+// and the visitors are templates so the per-square call inlines on the hot paths
+// (drawFrame walks the grid several times every frame)
+//
+
 class Grid
 {
 public:
+    // allocation free view of a square's graph neighbors, usable in a range for
+    class SquareRange
+    {
+    public:
+        class iterator
+        {
+        public:
+            iterator(const int* index, ChessSquare* squares) : _index(index), _squares(squares) {}
+            ChessSquare* operator*() const { return &_squares[*_index]; }
+            iterator& operator++() { ++_index; return *this; }
+            bool operator!=(const iterator& other) const { return _index != other._index; }
+        private:
+            const int* _index;
+            ChessSquare* _squares;
+        };
+
+        SquareRange(std::span<const int> indices, ChessSquare* squares) : _indices(indices), _squares(squares) {}
+        iterator begin() const { return iterator(_indices.data(), _squares); }
+        iterator end() const { return iterator(_indices.data() + _indices.size(), _squares); }
+        size_t size() const { return _indices.size(); }
+        bool empty() const { return _indices.empty(); }
+    private:
+        std::span<const int> _indices;
+        ChessSquare* _squares;
+    };
+
     Grid(int width, int height);
     ~Grid();
 
@@ -41,25 +76,68 @@ public:
     ChessSquare* getBRBR(int x, int y) { auto s = getBR(x, y); return s ? getBR(s->getColumn(), s->getRow()) : nullptr; }
 
     // Graph connections (for Hitman Go style games)
+    // connections are collected during board setup and frozen into a compressed
+    // sparse row table (plus an adjacency bit matrix for small boards) by
+    // freezeConnections(), or by the first query after a change
     void addConnection(int fromIndex, int toIndex);
     void addConnection(int fromX, int fromY, int toX, int toY);
-    std::vector<ChessSquare*> getConnectedSquares(int x, int y);
+    void freezeConnections();
+    SquareRange getConnectedSquares(int x, int y);
+    std::span<const int> getConnectedIndices(int index);
     bool areConnected(int fromX, int fromY, int toX, int toY);
+    bool areConnected(int fromIndex, int toIndex);
 
 
-    void forEachSquare(std::function<void(ChessSquare*, int x, int y)> func);
-    void forEachEnabledSquare(std::function<void(ChessSquare*, int x, int y)> func);
+    template <typename F>
+    void forEachSquare(F &&func)
+    {
+        int index = 0;
+        for (int y = 0; y < _height; y++) {
+            for (int x = 0; x < _width; x++, index++) {
+                func(&_squares[index], x, y);
+            }
+        }
+    }
+
+    template <typename F>
+    void forEachEnabledSquare(F &&func)
+    {
+        // a word of the mask at a time, jumping straight to the set bits
+        for (size_t word = 0; word < _enabled.size(); word++) {
+            uint64_t bits = _enabled[word];
+            while (bits) {
+                int index = (int)(word * 64) + std::countr_zero(bits);
+                bits &= bits - 1;
+                func(&_squares[index], index % _width, index / _width);
+            }
+        }
+    }
 
     void initializeSquares(float squareSize, const char* spriteName);
     void initializeSquare(int x, int y, float squareSize, const char* spriteName);
 
+    // the enabled square under a point, or nullptr
+    // the squares sit on a regular lattice, so this is a division, not a scan
+    ChessSquare* getSquareAtPoint(const ImVec2& point);
+    float getSquareSize() const { return _squareSize; }
+    // the SpriteStore group of the squares and every piece placed on them
+    int getSpriteGroup() const { return _spriteGroup; }
+
     std::string getStateString() const;
     void setStateString(const std::string& state);
 
 private:
-    std::vector<std::vector<ChessSquare*>> _squares;
-    std::vector<std::vector<bool>> _enabled;
-    std::unordered_map<int, std::vector<int>> _connections;
+    bool enabledAt(int index) const { return (_enabled[index >> 6] >> (index & 63)) & 1; }
+
+    std::unique_ptr<ChessSquare[]> _squares;
+    std::vector<uint64_t> _enabled;
+    std::vector<std::pair<int, int>> _edges;        // as added, until frozen
+    std::vector<int> _rowStart;                     // CSR: square i's neighbors are
+    std::vector<int> _neighbors;                    // _neighbors[_rowStart[i] .. _rowStart[i + 1])
+    std::vector<uint64_t> _adjacency;               // from * count + to bits, empty on big boards
+    bool _frozen;
+    float _squareSize;                              // lattice pitch, 0 until a square is initialized
+    int _spriteGroup;
     int _width;
     int _height;
 };
\ No newline at end of file
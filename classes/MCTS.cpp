@@ -0,0 +1,353 @@
+#include "MCTS.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+MCTS::MCTS(const MCTSRules &rules) : _rules(rules), _capacity(0), _used(0), _root(-1), _iterations(0), _stop(false), _sliceSpent(0)
+{
+}
+
+MCTS::~MCTS()
+{
+}
+
+void MCTS::reset()
+{
+    _root = -1;
+    _rootState.clear();
+    _used = 0;
+}
+
+void MCTS::initNode(int index, int move, int player, float prior)
+{
+    Node &node = _nodes[index];
+    node.visits.store(0, std::memory_order_relaxed);
+    node.score.store(0, std::memory_order_relaxed);
+    node.firstChild.store(Unexpanded, std::memory_order_relaxed);
+    node.childCount = 0;
+    node.move = move;
+    node.player = player;
+    node.prior = prior;
+}
+
+void MCTS::resetTo(const std::string &state)
+{
+    if (!_nodes || _capacity != _config.arenaSize) {
+        _capacity = _config.arenaSize;
+        _nodes.reset(new Node[_capacity]);
+    }
+    _used = 1;
+    _root = 0;
+    _rootState = state;
+    // the root belongs to whoever moved into it
+    initNode(_root, NoMove, 1 - _rules.currentPlayer(state), 1.0f);
+}
+
+int MCTS::findChild(int parent, const std::string &parentState, const std::string &state) const
+{
+    int first = _nodes[parent].firstChild.load(std::memory_order_acquire);
+    if (first < 0) {
+        return -1;
+    }
+    for (int i = 0; i < _nodes[parent].childCount; i++) {
+        std::string childState = parentState;
+        _rules.playMove(childState, _nodes[first + i].move);
+        if (childState == state) {
+            return first + i;
+        }
+    }
+    return -1;
+}
+
+//
+// keep the old tree if the new position is the root, a child or a grandchild
+// re-rooting leaves the old nodes behind, so start over once most of the arena is gone
+//
+bool MCTS::reuseTree(const std::string &state)
+{
+    if (_root < 0 || _used > _capacity / 4 * 3) {
+        return false;
+    }
+    if (state == _rootState) {
+        return true;
+    }
+
+    int first = _nodes[_root].firstChild.load(std::memory_order_acquire);
+    if (first < 0) {
+        return false;
+    }
+    int child = findChild(_root, _rootState, state);
+    for (int i = 0; child < 0 && i < _nodes[_root].childCount; i++) {
+        std::string childState = _rootState;
+        _rules.playMove(childState, _nodes[first + i].move);
+        child = findChild(first + i, childState, state);
+    }
+    if (child < 0) {
+        return false;
+    }
+    _root = child;
+    _rootState = state;
+    return true;
+}
+
+int MCTS::search(const std::string &state, bool pondering)
+{
+    if (!reuseTree(state)) {
+        resetTo(state);
+    }
+    if (_rules.result(state) != MCTSRules::Ongoing) {
+        return NoMove;
+    }
+
+    _iterations = _nodes[_root].visits.load();
+    _stop = false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_config.timeBudgetMs);
+
+    ThreadPool &pool = ThreadPool::instance();
+    int threads = _config.threads > 0 ? _config.threads : (int)pool.size();
+    unsigned int seed = (unsigned int)std::chrono::steady_clock::now().time_since_epoch().count();
+    std::vector<std::future<void>> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(pool.submit([this, seed, i, deadline, pondering]() { runWorker(seed + i, deadline, pondering); }));
+    }
+    for (auto &worker : workers) {
+        pool.wait(worker);
+    }
+
+    return bestMove();
+}
+
+void MCTS::begin(const std::string &state)
+{
+    if (!reuseTree(state)) {
+        resetTo(state);
+    }
+    _iterations = _nodes[_root].visits.load();
+    _stop = false;
+    _sliceSpent = std::chrono::steady_clock::duration::zero();
+    _sliceRng.seed((unsigned int)std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+bool MCTS::step(int microseconds)
+{
+    if (_root < 0 || _rules.result(_rootState) != MCTSRules::Ongoing) {
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::microseconds(microseconds);
+    bool spent = false;
+    while (!_stop) {
+        if (_iterations >= _config.maxIterations) {
+            spent = true;
+            break;
+        }
+        _iterations++;
+        iterate(_sliceRng, _slicePath, _sliceMoves);
+        // a slice is only a few milliseconds, so unlike runWorker read the clock every
+        // iteration; a long playout overshooting it would show up as a dropped frame
+        if (std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+    }
+    _sliceSpent += std::chrono::steady_clock::now() - start;
+    return spent || _stop || _sliceSpent >= std::chrono::milliseconds(_config.timeBudgetMs);
+}
+
+int MCTS::bestMove() const
+{
+    if (_root < 0 || _rules.result(_rootState) != MCTSRules::Ongoing) {
+        return NoMove;
+    }
+    // the most visited move is the most robust choice
+    int first = _nodes[_root].firstChild.load(std::memory_order_acquire);
+    int best = NoMove;
+    int bestVisits = -1;
+    for (int i = 0; first >= 0 && i < _nodes[_root].childCount; i++) {
+        const Node &child = _nodes[first + i];
+        if (child.visits > bestVisits) {
+            bestVisits = child.visits;
+            best = child.move;
+        }
+    }
+    if (best == NoMove) {
+        std::vector<int> moves;
+        _rules.generateMoves(_rootState, moves);
+        if (!moves.empty()) {
+            best = moves[0];
+        }
+    }
+    return best;
+}
+
+void MCTS::rootStats(std::vector<MoveStats> &stats) const
+{
+    stats.clear();
+    if (_root < 0) {
+        return;
+    }
+    int first = _nodes[_root].firstChild.load(std::memory_order_acquire);
+    for (int i = 0; first >= 0 && i < _nodes[_root].childCount; i++) {
+        const Node &child = _nodes[first + i];
+        int visits = child.visits;
+        float winRate = visits > 0 ? child.score / (2.0f * visits) : 0.0f;
+        stats.push_back({child.move, visits, winRate});
+    }
+}
+
+void MCTS::runWorker(unsigned int seed, std::chrono::steady_clock::time_point deadline, bool pondering)
+{
+    std::mt19937 rng(seed);
+    std::vector<int> path;
+    std::vector<int> moves;
+    int count = 0;
+    while (!_stop) {
+        if (pondering) {
+            if (_used >= _capacity / 2) {
+                break;
+            }
+            _iterations++;
+            iterate(rng, path, moves);
+            continue;
+        }
+        if (_iterations.fetch_add(1) >= _config.maxIterations) {
+            break;
+        }
+        // reading the clock every iteration costs more than a small playout
+        if ((++count & 15) == 0 && std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        iterate(rng, path, moves);
+    }
+}
+
+int MCTS::selectChild(int index, std::mt19937 &rng) const
+{
+    const Node &node = _nodes[index];
+    int first = node.firstChild.load(std::memory_order_acquire);
+    float parentVisits = (float)std::max(1, node.visits.load(std::memory_order_relaxed));
+    float logParent = std::log(parentVisits);
+    float sqrtParent = std::sqrt(parentVisits);
+    float priorSum = 0.0f;
+    if (_config.usePUCT) {
+        for (int i = 0; i < node.childCount; i++) {
+            priorSum += _nodes[first + i].prior;
+        }
+    }
+
+    int best = first;
+    float bestValue = -1.0f;
+    // start the unvisited scan at a random child so threads spread out
+    int offset = node.childCount > 1 ? (int)(rng() % node.childCount) : 0;
+    for (int n = 0; n < node.childCount; n++) {
+        int i = (n + offset) % node.childCount;
+        const Node &child = _nodes[first + i];
+        int visits = child.visits.load(std::memory_order_relaxed);
+        float value;
+        if (_config.usePUCT) {
+            float q = visits > 0 ? child.score.load(std::memory_order_relaxed) / (2.0f * visits) : 0.5f;
+            float p = priorSum > 0.0f ? child.prior / priorSum : 1.0f / node.childCount;
+            value = q + _config.exploration * p * sqrtParent / (1.0f + visits);
+        } else {
+            if (visits == 0) {
+                return first + i;
+            }
+            float q = child.score.load(std::memory_order_relaxed) / (2.0f * visits);
+            value = q + _config.exploration * std::sqrt(logParent / visits);
+        }
+        if (value > bestValue) {
+            bestValue = value;
+            best = first + i;
+        }
+    }
+    return best;
+}
+
+bool MCTS::expand(int index, const std::string &state, std::vector<int> &moves)
+{
+    Node &node = _nodes[index];
+    int expected = Unexpanded;
+    if (!node.firstChild.compare_exchange_strong(expected, Expanding)) {
+        return false;
+    }
+
+    moves.clear();
+    _rules.generateMoves(state, moves);
+    int count = (int)moves.size();
+    int base = count > 0 ? _used.fetch_add(count) : 0;
+    if (count == 0 || base + count > _capacity) {
+        node.firstChild.store(NoChildren, std::memory_order_release);
+        return false;
+    }
+
+    int player = _rules.currentPlayer(state);
+    for (int i = 0; i < count; i++) {
+        float prior = _config.usePUCT ? _rules.prior(state, moves[i]) : 1.0f;
+        initNode(base + i, moves[i], player, prior);
+    }
+    node.childCount = count;
+    node.firstChild.store(base, std::memory_order_release);
+    return true;
+}
+
+void MCTS::iterate(std::mt19937 &rng, std::vector<int> &path, std::vector<int> &moves)
+{
+    std::string state = _rootState;
+    path.clear();
+    int index = _root;
+
+    // search() only runs on an unfinished root
+    int status = MCTSRules::Ongoing;
+
+    // selection, charging a virtual loss on the way down
+    while (status == MCTSRules::Ongoing) {
+        int first = _nodes[index].firstChild.load(std::memory_order_acquire);
+        if (first < 0) {
+            if (first != Unexpanded || !expand(index, state, moves)) {
+                break;
+            }
+        }
+        index = selectChild(index, rng);
+        _nodes[index].visits.fetch_add(_config.virtualLoss, std::memory_order_relaxed);
+        path.push_back(index);
+        _rules.playMove(state, _nodes[index].move);
+        status = _rules.resultAfterMove(state, _nodes[index].move);
+        if (_nodes[index].visits.load(std::memory_order_relaxed) <= _config.virtualLoss) {
+            // first visit to this node, roll out from here
+            break;
+        }
+    }
+
+    int winner = status == MCTSRules::Ongoing ? playout(state, rng, moves) : status;
+
+    // backpropagation, swapping each virtual loss for the real visit
+    for (int nodeIndex : path) {
+        Node &node = _nodes[nodeIndex];
+        int points = winner == node.player ? 2 : (winner == MCTSRules::Draw ? 1 : 0);
+        node.score.fetch_add(points, std::memory_order_relaxed);
+        node.visits.fetch_add(1 - _config.virtualLoss, std::memory_order_relaxed);
+    }
+    Node &root = _nodes[_root];
+    root.score.fetch_add(winner == root.player ? 2 : (winner == MCTSRules::Draw ? 1 : 0), std::memory_order_relaxed);
+    root.visits.fetch_add(1, std::memory_order_relaxed);
+}
+
+int MCTS::playout(std::string &state, std::mt19937 &rng, std::vector<int> &moves) const
+{
+    // called on an unfinished position, each move then judges itself
+    for (int ply = 0; ply < _config.maxPlayoutLength; ply++) {
+        moves.clear();
+        _rules.generateMoves(state, moves);
+        if (moves.empty()) {
+            return MCTSRules::Draw;
+        }
+        int move = moves[rng() % moves.size()];
+        _rules.playMove(state, move);
+        int result = _rules.resultAfterMove(state, move);
+        if (result != MCTSRules::Ongoing) {
+            return result;
+        }
+    }
+    return MCTSRules::Draw;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+// the small rules interface a game implements to be searched by MCTS
+// positions are opaque strings (usually the game's state string plus whatever
+// else the rules need, like the side to move) and moves are game defined ints
+//
+class MCTSRules
+{
+public:
+    static const int Ongoing = -2;
+    static const int Draw = -1;
+
+    virtual ~MCTSRules() {}
+
+    // player to move, 0 or 1
+    virtual int currentPlayer(const std::string &state) const = 0;
+    // fill in the legal moves for the player to move
+    virtual void generateMoves(const std::string &state, std::vector<int> &moves) const = 0;
+    virtual void playMove(std::string &state, int move) const = 0;
+    // winning player number, Draw, or Ongoing
+    virtual int result(const std::string &state) const = 0;
+    // the same, for a position the given move just led to; rules that can judge
+    // from the move alone (the lines through a dropped stone) skip the full scan
+    virtual int resultAfterMove(const std::string &state, int move) const { return result(state); }
+    // prior probability of a move for PUCT selection, uniform by default
+    virtual float prior(const std::string &state, int move) const { return 1.0f; }
+    // static score for the player to move, used by the analyser at its depth limit
+    virtual int evaluate(const std::string &state) const { return 0; }
+    // how a move is shown to the player
+    virtual std::string moveName(int move) const { return std::to_string(move); }
+};
+
+//
+// game agnostic monte carlo tree search
+// runs tree parallel on the shared thread pool with virtual loss, keeps its
+// nodes in a preallocated arena and reuses the subtree of the previous search
+// when the new position is a child or grandchild of the old root
+//
+class MCTS
+{
+public:
+    static const int NoMove = -1;
+
+    struct Config {
+        float exploration = 1.4f;       // UCT constant, or the PUCT constant when usePUCT is set
+        bool usePUCT = false;
+        int virtualLoss = 3;            // visits charged to a node while a thread is below it
+        int maxIterations = 20000;      // counts visits already in a reused tree, so a warm tree answers at once
+        int timeBudgetMs = 500;
+        int maxPlayoutLength = 400;     // longer playouts count as a draw
+        int threads = 0;                // 0 uses the whole pool
+        int arenaSize = 1 << 19;
+    };
+
+    struct MoveStats {
+        int move;
+        int visits;
+        float winRate;                  // for the player making the move
+    };
+
+    explicit MCTS(const MCTSRules &rules);
+    ~MCTS();
+
+    Config &config() { return _config; }
+
+    // search the position and return the most visited move, or NoMove if there are none
+    // a pondering search ignores the time and iteration budget and runs until stop()
+    // or until the tree fills half the arena, so the next search can still reuse it
+    int search(const std::string &state, bool pondering = false);
+    // the same search spread over many short calls on the caller's thread, for builds
+    // without threads. begin() sets up the position, then each step() searches for about
+    // the given time and returns true once the iteration or time budget is spent (only
+    // time inside step() counts against it), and bestMove() has the answer
+    void begin(const std::string &state);
+    bool step(int microseconds);
+    int bestMove() const;
+    // ask a running search to finish early
+    void stop() { _stop = true; }
+    // throw the tree away
+    void reset();
+
+    void rootStats(std::vector<MoveStats> &stats) const;
+    int iterations() const { return _iterations; }
+    int nodesUsed() const { return _used; }
+
+private:
+    static const int Unexpanded = -1;
+    static const int Expanding = -2;
+    static const int NoChildren = -3;
+
+    struct Node {
+        std::atomic<int> visits;
+        std::atomic<int> score;         // half points for the player who moved into this node
+        std::atomic<int> firstChild;    // arena index, or one of the markers above
+        int childCount;
+        int move;
+        int player;
+        float prior;
+    };
+
+    void initNode(int index, int move, int player, float prior);
+    void resetTo(const std::string &state);
+    bool reuseTree(const std::string &state);
+    int findChild(int parent, const std::string &parentState, const std::string &state) const;
+    void runWorker(unsigned int seed, std::chrono::steady_clock::time_point deadline, bool pondering);
+    void iterate(std::mt19937 &rng, std::vector<int> &path, std::vector<int> &moves);
+    bool expand(int index, const std::string &state, std::vector<int> &moves);
+    int selectChild(int index, std::mt19937 &rng) const;
+    int playout(std::string &state, std::mt19937 &rng, std::vector<int> &moves) const;
+
+    const MCTSRules &_rules;
+    Config _config;
+    std::unique_ptr<Node[]> _nodes;
+    int _capacity;
+    std::atomic<int> _used;
+    int _root;
+    std::string _rootState;
+    std::atomic<int> _iterations;
+    std::atomic<bool> _stop;
+
+    // a sliced search's working state, kept between steps
+    std::mt19937 _sliceRng;
+    std::vector<int> _slicePath;
+    std::vector<int> _sliceMoves;
+    std::chrono::steady_clock::duration _sliceSpent;
+};
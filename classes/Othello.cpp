@@ -11,9 +11,14 @@ Othello::Othello() : Game() {
     _grid = new Grid(8, 8);
     _consecutivePasses = 0;
     _showingHints = false;
+    _animateFlips = true;
+    _discTextures[0] = _discTextures[1] = 0;
+    _discSize = ImVec2(0, 0);
 }
 
 Othello::~Othello() {
+    // a background search still refers to our rules
+    stopPondering();
     delete _grid;
 }
 
@@ -47,13 +52,29 @@ void Othello::setUpBoard() {
     startGame();
 }
 
+ImTextureID Othello::discTexture(Player* player) {
+    int face = player == getPlayerAt(BLACK_PLAYER) ? BLACK_PLAYER : WHITE_PLAYER;
+    if (!_discTextures[face]) {
+        _discTextures[face] = Sprite::loadTexture(face == BLACK_PLAYER ? "o.png" : "x.png", _discSize);
+    }
+    return _discTextures[face];
+}
+
 Bit* Othello::createPiece(Player* player) {
     Bit* bit = new Bit();
-    bit->LoadTextureFromFile(player == getPlayerAt(BLACK_PLAYER) ? "o.png" : "x.png");
+    bit->setTexture(discTexture(player), _discSize);
     bit->setOwner(player);
     return bit;
 }
 
+//
+// a flipped disc keeps its Bit, only the owner and the face change
+//
+void Othello::flipPiece(Bit* piece, Player* player, bool animate) {
+    piece->setOwner(player);
+    piece->flipTo(discTexture(player), animate);
+}
+
 bool Othello::actionForEmptyHolder(BitHolder &holder) {
     if (holder.bit()) return false;
 
@@ -65,6 +86,8 @@ bool Othello::actionForEmptyHolder(BitHolder &holder) {
     if (!isValidMove(x, y, currentPlayer)) return false;
 
     // Place the piece
+    beginMove();
+    recordSquare(_grid->getIndex(x, y));
     Bit* newPiece = createPiece(currentPlayer);
     newPiece->setPosition(holder.getPosition());
     holder.setBit(newPiece);
@@ -79,6 +102,7 @@ bool Othello::actionForEmptyHolder(BitHolder &holder) {
         _consecutivePasses++;
         if (hasValidMove(currentPlayer)) {
             // Next player passes, current player continues
+            commitMove();
             return true;
         } else {
             _consecutivePasses = 2; // Game ends
@@ -147,10 +171,8 @@ void Othello::flipInDirection(int x, int y, int dx, int dy, Player* player, int
     for (int i = 0; i < count; i++) {
         ChessSquare* square = _grid->getSquare(nx, ny);
         if (square && square->bit()) {
-            square->destroyBit();
-            Bit* newPiece = createPiece(player);
-            newPiece->setPosition(square->getPosition());
-            square->setBit(newPiece);
+            recordSquare(_grid->getIndex(nx, ny));
+            flipPiece(square->bit(), player, _animateFlips);
         }
         nx += dx;
         ny += dy;
@@ -205,6 +227,19 @@ Player* Othello::checkForWinner() {
     return nullptr;
 }
 
+//
+// placing a disc already worked out whether anyone can still move, so the
+// board only needs counting once the game is really over
+//
+int Othello::lastMoveResult() {
+    if (_consecutivePasses < 2) return MCTSRules::Ongoing;
+    int blackCount, whiteCount;
+    countPieces(blackCount, whiteCount);
+    if (blackCount > whiteCount) return BLACK_PLAYER;
+    if (whiteCount > blackCount) return WHITE_PLAYER;
+    return MCTSRules::Draw;
+}
+
 bool Othello::checkForDraw() {
     if (_consecutivePasses >= 2 ||
         (!hasValidMove(getPlayerAt(BLACK_PLAYER)) && !hasValidMove(getPlayerAt(WHITE_PLAYER)))) {
@@ -247,6 +282,7 @@ void Othello::stopGame() {
         square->destroyBit();
     });
     _consecutivePasses = 0;
+    forgetLooseBits();
 }
 
 std::string Othello::initialStateString() {
@@ -273,58 +309,54 @@ std::string Othello::stateString() {
     return state;
 }
 
+//
+// only touch the squares that differ from the board. a disc that changes
+// color is turned over in place, everything else is left alone
+//
 void Othello::setStateString(const std::string &s) {
     if (s.length() != 64) return;
 
-    int index = 0;
-    _grid->forEachSquare([&](ChessSquare* square, int x, int y) {
-        if (index < s.length()) {
-            char pieceType = s[index++];
-            square->destroyBit();
-
-            if (pieceType == '1') {
-                Bit* piece = createPiece(getPlayerAt(BLACK_PLAYER));
-                piece->setPosition(square->getPosition());
-                square->setBit(piece);
-            } else if (pieceType == '2') {
-                Bit* piece = createPiece(getPlayerAt(WHITE_PLAYER));
-                piece->setPosition(square->getPosition());
-                square->setBit(piece);
-            }
-        }
-    });
+    clearMoveHistory();
+    std::string current = stateString();
+    for (int index = 0; index < 64; index++) {
+        if (current[index] != s[index]) setSquareState(index, s[index]);
+    }
 }
 
-void Othello::updateAI() {
-    if (!gameHasAI()) return;
-
-    Player* aiPlayer = getCurrentPlayer();
-    std::vector<std::pair<int, int>> validMoves = getValidMoves(aiPlayer);
+char Othello::squareState(int index) {
+    Bit* bit = _grid->getSquareByIndex(index)->bit();
+    if (!bit) return '0';
+    return bit->getOwner() == getPlayerAt(BLACK_PLAYER) ? '1' : '2';
+}
 
-    if (validMoves.empty()) {
-        _consecutivePasses++;
-        endTurn();
+void Othello::setSquareState(int index, char state) {
+    ChessSquare* square = _grid->getSquareByIndex(index);
+    if (state != '1' && state != '2') {
+        square->destroyBit();
         return;
     }
-
-    // Find move that flips the most pieces
-    int bestX = -1, bestY = -1, maxFlips = 0;
-
-    for (const auto& move : validMoves) {
-        int x = move.first, y = move.second, totalFlips = 0;
-        for (int i = 0; i < 8; i++) {
-            totalFlips += checkDirection(x, y, DIRECTIONS[i][0], DIRECTIONS[i][1], aiPlayer);
-        }
-        if (totalFlips > maxFlips) {
-            maxFlips = totalFlips;
-            bestX = x;
-            bestY = y;
-        }
+    Player* player = getPlayerAt(state == '1' ? BLACK_PLAYER : WHITE_PLAYER);
+    if (square->bit()) {
+        flipPiece(square->bit(), player, false);
+        return;
     }
+    Bit* piece = createPiece(player);
+    piece->setPosition(square->getPosition());
+    square->setBit(piece);
+}
+
+std::string Othello::searchState() {
+    return stateString() + (char)('0' + getCurrentPlayer()->playerNumber());
+}
 
-    if (bestX >= 0 && bestY >= 0) {
-        actionForEmptyHolder(*_grid->getSquare(bestX, bestY));
+void Othello::applySearchMove(int move) {
+    if (move == OthelloRules::PASS) {
+        beginMove();
+        _consecutivePasses++;
+        endTurn();
+        return;
     }
+    actionForEmptyHolder(*_grid->getSquare(move % 8, move / 8));
 }
 
 void Othello::getBoardPosition(BitHolder& holder, int &x, int &y) const {
@@ -339,4 +371,102 @@ void Othello::showValidMoves(Player* player) {
 
 void Othello::clearValidMoveIndicators() {
     _showingHints = false;
-}
\ No newline at end of file
+}
+
+//
+// search rules: '1' is black (player 0) and '2' is white (player 1)
+//
+int OthelloRules::currentPlayer(const std::string &state) const {
+    return state[64] - '0';
+}
+
+int OthelloRules::flips(const std::string &state, int x, int y, int dx, int dy, char piece) const {
+    int count = 0;
+    int nx = x + dx;
+    int ny = y + dy;
+    while (nx >= 0 && nx < 8 && ny >= 0 && ny < 8) {
+        char c = state[ny * 8 + nx];
+        if (c == '0') return 0;
+        if (c == piece) return count;
+        count++;
+        nx += dx;
+        ny += dy;
+    }
+    return 0;
+}
+
+bool OthelloRules::hasMove(const std::string &state, char piece) const {
+    for (int i = 0; i < 64; i++) {
+        if (state[i] != '0') continue;
+        for (int d = 0; d < 8; d++) {
+            if (flips(state, i % 8, i / 8, Othello::DIRECTIONS[d][0], Othello::DIRECTIONS[d][1], piece) > 0) return true;
+        }
+    }
+    return false;
+}
+
+void OthelloRules::generateMoves(const std::string &state, std::vector<int> &moves) const {
+    char piece = currentPlayer(state) == 0 ? '1' : '2';
+    for (int i = 0; i < 64; i++) {
+        if (state[i] != '0') continue;
+        for (int d = 0; d < 8; d++) {
+            if (flips(state, i % 8, i / 8, Othello::DIRECTIONS[d][0], Othello::DIRECTIONS[d][1], piece) > 0) {
+                moves.push_back(i);
+                break;
+            }
+        }
+    }
+    // a player without a move passes, as long as the game isn't over
+    if (moves.empty() && hasMove(state, piece == '1' ? '2' : '1')) {
+        moves.push_back(PASS);
+    }
+}
+
+void OthelloRules::playMove(std::string &state, int move) const {
+    int player = currentPlayer(state);
+    if (move != PASS) {
+        char piece = player == 0 ? '1' : '2';
+        int x = move % 8;
+        int y = move / 8;
+        for (int d = 0; d < 8; d++) {
+            int dx = Othello::DIRECTIONS[d][0];
+            int dy = Othello::DIRECTIONS[d][1];
+            int count = flips(state, x, y, dx, dy, piece);
+            for (int i = 1; i <= count; i++) {
+                state[(y + dy * i) * 8 + x + dx * i] = piece;
+            }
+        }
+        state[move] = piece;
+    }
+    state[64] = (char)('0' + (1 - player));
+}
+
+int OthelloRules::result(const std::string &state) const {
+    if (hasMove(state, '1') || hasMove(state, '2')) return Ongoing;
+    int black = (int)std::count(state.begin(), state.begin() + 64, '1');
+    int white = (int)std::count(state.begin(), state.begin() + 64, '2');
+    if (black > white) return 0;
+    if (white > black) return 1;
+    return Draw;
+}
+
+int OthelloRules::evaluate(const std::string &state) const {
+    // discs, weighted heavily toward the corners that can never be flipped
+    static const int corners[4] = {0, 7, 56, 63};
+    char mine = currentPlayer(state) == 0 ? '1' : '2';
+    int score = 0;
+    for (int i = 0; i < 64; i++) {
+        if (state[i] == '0') continue;
+        score += state[i] == mine ? 1 : -1;
+    }
+    for (int corner : corners) {
+        if (state[corner] == '0') continue;
+        score += state[corner] == mine ? 25 : -25;
+    }
+    return score;
+}
+
+std::string OthelloRules::moveName(int move) const {
+    if (move == PASS) return "pass";
+    return std::string(1, (char)('a' + move % 8)) + std::to_string(move / 8 + 1);
+}
@@ -5,6 +5,27 @@
 // NOTE: This implementation assumes black.png and white.png exist in resources.
 // If not, you can use o.png and x.png, or any other suitable graphics.
 
+//
+// Othello rules for MCTS
+// the position is the 64 character state string followed by the player to move
+//
+class OthelloRules : public MCTSRules
+{
+public:
+    static const int PASS = 64;
+
+    int         currentPlayer(const std::string &state) const override;
+    void        generateMoves(const std::string &state, std::vector<int> &moves) const override;
+    void        playMove(std::string &state, int move) const override;
+    int         result(const std::string &state) const override;
+    int         evaluate(const std::string &state) const override;
+    std::string moveName(int move) const override;
+
+private:
+    bool        hasMove(const std::string &state, char piece) const;
+    int         flips(const std::string &state, int x, int y, int dx, int dy, char piece) const;
+};
+
 class Othello : public Game
 {
 public:
@@ -15,6 +36,7 @@ public:
     void        setUpBoard() override;
     Player*     checkForWinner() override;
     bool        checkForDraw() override;
+    int         lastMoveResult() override;
     std::string initialStateString() override;
     std::string stateString() override;
     void        setStateString(const std::string &s) override;
@@ -23,12 +45,25 @@ public:
     bool        canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
     void        stopGame() override;
 
-    // AI methods
-    void        updateAI() override;
+    // AI methods, played by MCTS through the search rules
     bool        gameHasAI() override { return true; } // Set to true when AI is implemented
     Grid* getGrid() override { return _grid; }
+    MCTSRules*  searchRules() override { return &_rules; }
+    std::string searchState() override;
+    void        applySearchMove(int move) override;
+
+    // turn flipped discs over on screen, or just swap them
+    void        setAnimateFlips(bool animate) { _animateFlips = animate; }
+
+protected:
+    char        squareState(int index) override;
+    void        setSquareState(int index, char state) override;
+    int         moveExtra() override { return _consecutivePasses; }
+    void        setMoveExtra(int extra) override { _consecutivePasses = extra; }
 
 private:
+    friend class OthelloRules;
+
     // Player constants
     static const int BLACK_PLAYER = 0;
     static const int WHITE_PLAYER = 1;
@@ -38,6 +73,8 @@ private:
 
     // Helper methods
     Bit*        createPiece(Player* player);
+    void        flipPiece(Bit* piece, Player* player, bool animate);
+    ImTextureID discTexture(Player* player);
     bool        isValidMove(int x, int y, Player* player) const;
     int         checkDirection(int x, int y, int dx, int dy, Player* player) const;
     void        flipPieces(int x, int y, Player* player);
@@ -53,8 +90,14 @@ private:
 
     // Board representation
     Grid*       _grid;
+    OthelloRules _rules;
 
     // Game state
     int         _consecutivePasses;
     bool        _showingHints;
+    bool        _animateFlips;
+
+    // both disc faces, loaded once and shared by every disc on the board
+    ImTextureID _discTextures[2];
+    ImVec2      _discSize;
 };
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "PerfStats.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    std::atomic<uint64_t> allocations(0);
+    std::atomic<std::thread::id> frameThread;
+
+    // only the frame thread touches these
+    PerfStats::Frame frames[PerfStats::History];
+    int nextFrame = 0;
+    int frameCount = 0;
+    PerfStats::Frame current = {};
+    std::chrono::steady_clock::time_point frameStart;
+    uint64_t allocationsAtStart = 0;
+
+    std::mutex texturesLock;
+    std::unordered_map<ImTextureID, size_t> textures;
+    std::atomic<size_t> textureTotal(0);
+}
+
+//
+// every heap allocation in the process goes through here, one relaxed increment each
+// delete is replaced too so the pair always match, whatever the runtime's own do
+//
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) {
+        size = 1;
+    }
+    for (;;) {
+        if (void *block = std::malloc(size)) {
+            return block;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void *block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void *block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+PerfStats::Scope::Scope(Section section) : _section(section), _timing(std::this_thread::get_id() == frameThread.load(std::memory_order_relaxed))
+{
+    if (_timing) {
+        _start = std::chrono::steady_clock::now();
+    }
+}
+
+PerfStats::Scope::~Scope()
+{
+    if (_timing) {
+        current.sections[_section] += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - _start).count();
+    }
+}
+
+void PerfStats::beginFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    uint64_t allocated = allocations.load(std::memory_order_relaxed);
+    if (frameThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        current.milliseconds = std::chrono::duration<float, std::milli>(now - frameStart).count();
+        current.allocations = (int)(allocated - allocationsAtStart);
+        frames[nextFrame] = current;
+        nextFrame = (nextFrame + 1) % History;
+        frameCount = frameCount < History ? frameCount + 1 : History;
+    }
+    frameThread = std::this_thread::get_id();
+    current = Frame{};
+    frameStart = now;
+    allocationsAtStart = allocated;
+}
+
+void PerfStats::history(std::vector<Frame> &history)
+{
+    history.clear();
+    for (int i = 0; i < frameCount; i++) {
+        history.push_back(frames[(nextFrame - frameCount + i + History) % History]);
+    }
+}
+
+const char *PerfStats::sectionName(Section section)
+{
+    static const char *names[SectionCount] = {"updateAI", "drawFrame", "scanForMouse", "endTurn", "idle"};
+    return names[section];
+}
+
+void PerfStats::textureCreated(ImTextureID texture, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(texturesLock);
+    textures[texture] = bytes;
+    textureTotal += bytes;
+}
+
+void PerfStats::textureReleased(ImTextureID texture)
+{
+    std::lock_guard<std::mutex> lock(texturesLock);
+    auto found = textures.find(texture);
+    if (found != textures.end()) {
+        textureTotal -= found->second;
+        textures.erase(found);
+    }
+}
+
+size_t PerfStats::textureBytes()
+{
+    return textureTotal;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../imgui/imgui.h"
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+//
+// where the frame time goes, for the demo's performance overlay
+// a Scope times a section of the frame (the AI, drawing, input, turns) on the
+// thread that runs the frames; boards simulated on workers aren't counted.
+// heap allocations are counted process wide by replacing operator new, and
+// texture memory as textures are uploaded and freed. beginFrame() closes one
+// frame's numbers into a short history and starts the next
+//
+class PerfStats
+{
+public:
+    enum Section
+    {
+        UpdateAI,
+        DrawFrame,
+        ScanForMouse,
+        EndTurn,
+        Idle,           // the main loop waiting for input
+        SectionCount
+    };
+    static const int History = 240;
+
+    struct Frame
+    {
+        float milliseconds;                 // since the frame before
+        float sections[SectionCount];       // milliseconds in each section
+        int allocations;
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(Section section);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Section _section;
+        bool _timing;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    // called once a frame by the thread that runs them
+    static void beginFrame();
+    // the last History frames, oldest first
+    static void history(std::vector<Frame> &frames);
+    static const char *sectionName(Section section);
+
+    static void textureCreated(ImTextureID texture, size_t bytes);
+    static void textureReleased(ImTextureID texture);
+    static size_t textureBytes();
+};
@@ -1,10 +1,11 @@
 #pragma once
 #include <iostream>
 #include <map>
+#include "Pooled.h"
 
 class Game;
 
-class Player
+class Player : public Pooled<Player>
 {
 public:
 	Player() : _game(nullptr), _name(""), _extraValues(), _aiPlayer(false) {};
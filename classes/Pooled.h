@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+//
+// recycled storage for small objects that come and go every move (bits, turns, players)
+// a class opts in by deriving from Pooled<itself>; new and delete then take blocks
+// from a per thread free list instead of the heap. the list keeps at most
+// MaxFree blocks so memory stays flat however many games are played, and
+// games running on other threads never contend for it. a block freed on
+// another thread than it came from just joins that thread's list.
+//
+template <typename T>
+class Pooled
+{
+public:
+    static const size_t MaxFree = 1024;
+
+    static void *operator new(size_t size)
+    {
+        std::vector<void *> &blocks = freeBlocks().blocks;
+        if (size != sizeof(T) || blocks.empty())
+        {
+            return ::operator new(size);
+        }
+        void *block = blocks.back();
+        blocks.pop_back();
+        return block;
+    }
+
+    static void operator delete(void *block, size_t size)
+    {
+        if (!block)
+        {
+            return;
+        }
+        std::vector<void *> &blocks = freeBlocks().blocks;
+        if (size != sizeof(T) || blocks.size() >= MaxFree)
+        {
+            ::operator delete(block);
+            return;
+        }
+        blocks.push_back(block);
+    }
+
+    // blocks waiting to be reused on the calling thread
+    static size_t freeCount() { return freeBlocks().blocks.size(); }
+
+private:
+    struct FreeList
+    {
+        std::vector<void *> blocks;
+        ~FreeList()
+        {
+            for (void *block : blocks)
+            {
+                ::operator delete(block);
+            }
+        }
+    };
+
+    static FreeList &freeBlocks()
+    {
+        thread_local FreeList list;
+        return list;
+    }
+};
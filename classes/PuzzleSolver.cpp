@@ -0,0 +1,188 @@
+#include "PuzzleSolver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <queue>
+#include <tuple>
+
+PuzzleSolver::PuzzleSolver(const PuzzleRules &rules) : _rules(rules)
+{
+}
+
+int PuzzleSolver::shardOf(uint64_t state)
+{
+    // mix the bits first, packed states differ mostly in their low bits
+    state ^= state >> 33;
+    state *= 0xff51afd7ed558ccdULL;
+    state ^= state >> 33;
+    return (int)(state & (ShardCount - 1));
+}
+
+PuzzleSolver::Visit *PuzzleSolver::findVisit(uint64_t state)
+{
+    VisitedSet &shard = _visited[shardOf(state)];
+    auto found = shard.find(state);
+    return found != shard.end() ? &found->second : nullptr;
+}
+
+void PuzzleSolver::traceBack(uint64_t goal, Solution &solution)
+{
+    solution.solved = true;
+    uint64_t state = goal;
+    for (Visit *visit = findVisit(state); visit && visit->move >= 0; visit = findVisit(state)) {
+        solution.moves.push_back(visit->move);
+        state = visit->parent;
+    }
+    std::reverse(solution.moves.begin(), solution.moves.end());
+}
+
+void PuzzleSolver::expand(const std::vector<uint64_t> &frontier, size_t begin, size_t end, std::vector<Candidate> &out) const
+{
+    std::vector<std::pair<int, uint64_t>> next;
+    for (size_t i = begin; i < end; i++) {
+        next.clear();
+        _rules.successors(frontier[i], next);
+        for (const auto &move : next) {
+            out.push_back({move.second, frontier[i], move.first});
+        }
+    }
+}
+
+void PuzzleSolver::merge(int shard, int depth, const std::vector<std::vector<Candidate>> &candidates, std::vector<uint64_t> &next, uint64_t &goal, bool &found)
+{
+    VisitedSet &visited = _visited[shard];
+    for (const auto &batch : candidates) {
+        for (const Candidate &candidate : batch) {
+            if (shardOf(candidate.state) != shard) continue;
+            if (!visited.emplace(candidate.state, Visit{candidate.parent, candidate.move, depth}).second) continue;
+            if (!found && _rules.isGoal(candidate.state)) {
+                found = true;
+                goal = candidate.state;
+            }
+            next.push_back(candidate.state);
+        }
+    }
+}
+
+PuzzleSolver::Solution PuzzleSolver::solveBFS()
+{
+    auto started = std::chrono::steady_clock::now();
+    Solution solution;
+    _visited.assign(ShardCount, VisitedSet());
+
+    uint64_t start = _rules.initialState();
+    _visited[shardOf(start)].emplace(start, Visit{start, -1, 0});
+    bool found = _rules.isGoal(start);
+    uint64_t goal = start;
+
+    ThreadPool &pool = ThreadPool::instance();
+    int threads = _config.threads > 0 ? _config.threads : (int)pool.size();
+    std::vector<uint64_t> frontier(1, start);
+    size_t visitedCount = 1;
+
+    for (int depth = 1; !found && !frontier.empty() && visitedCount < _config.maxStates; depth++) {
+        // expand the level in chunks, one candidate list per chunk
+        int chunks = frontier.size() >= _config.parallelFrontier ? threads : 1;
+        std::vector<std::vector<Candidate>> candidates(chunks);
+        std::vector<std::future<void>> work;
+        for (int c = 1; c < chunks; c++) {
+            size_t begin = frontier.size() * c / chunks;
+            size_t end = frontier.size() * (c + 1) / chunks;
+            work.push_back(pool.submit([this, &frontier, &candidates, begin, end, c]() { expand(frontier, begin, end, candidates[c]); }));
+        }
+        expand(frontier, 0, frontier.size() / chunks, candidates[0]);
+        for (auto &task : work) {
+            pool.wait(task);
+        }
+
+        // each worker owns a set of shards, so inserts need no locks
+        std::vector<std::vector<uint64_t>> next(chunks);
+        std::vector<uint64_t> goals(chunks, 0);
+        std::vector<char> goalFound(chunks, 0);
+        auto mergeShards = [this, depth, chunks, &candidates, &next, &goals, &goalFound](int c) {
+            bool hit = false;
+            for (int shard = c; shard < ShardCount; shard += chunks) {
+                merge(shard, depth, candidates, next[c], goals[c], hit);
+            }
+            goalFound[c] = hit;
+        };
+        work.clear();
+        for (int c = 1; c < chunks; c++) {
+            work.push_back(pool.submit([&mergeShards, c]() { mergeShards(c); }));
+        }
+        mergeShards(0);
+        for (auto &task : work) {
+            pool.wait(task);
+        }
+
+        frontier.clear();
+        for (int c = 0; c < chunks; c++) {
+            visitedCount += next[c].size();
+            frontier.insert(frontier.end(), next[c].begin(), next[c].end());
+            if (goalFound[c] && !found) {
+                found = true;
+                goal = goals[c];
+            }
+        }
+    }
+
+    if (found) {
+        traceBack(goal, solution);
+    }
+    solution.statesVisited = visitedCount;
+    solution.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    _visited.clear();
+    return solution;
+}
+
+PuzzleSolver::Solution PuzzleSolver::solveAStar()
+{
+    auto started = std::chrono::steady_clock::now();
+    Solution solution;
+    _visited.assign(ShardCount, VisitedSet());
+
+    // (f, g, state), smallest f first and the deepest among equals
+    typedef std::tuple<int, int, uint64_t> OpenEntry;
+    auto worse = [](const OpenEntry &a, const OpenEntry &b) {
+        if (std::get<0>(a) != std::get<0>(b)) return std::get<0>(a) > std::get<0>(b);
+        return std::get<1>(a) < std::get<1>(b);
+    };
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, decltype(worse)> open(worse);
+
+    uint64_t start = _rules.initialState();
+    _visited[shardOf(start)].emplace(start, Visit{start, -1, 0});
+    open.emplace(_rules.heuristic(start), 0, start);
+
+    size_t visitedCount = 1;
+    std::vector<std::pair<int, uint64_t>> next;
+    while (!open.empty() && visitedCount < _config.maxStates) {
+        auto [f, g, state] = open.top();
+        open.pop();
+        if (findVisit(state)->depth < g) continue;      // a shorter path got here first
+        if (_rules.isGoal(state)) {
+            traceBack(state, solution);
+            break;
+        }
+
+        next.clear();
+        _rules.successors(state, next);
+        for (const auto &move : next) {
+            Visit *visit = findVisit(move.second);
+            if (visit && visit->depth <= g + 1) continue;
+            if (visit) {
+                *visit = Visit{state, move.first, g + 1};
+            } else {
+                _visited[shardOf(move.second)].emplace(move.second, Visit{state, move.first, g + 1});
+                visitedCount++;
+            }
+            open.emplace(g + 1 + _rules.heuristic(move.second), g + 1, move.second);
+        }
+    }
+
+    solution.statesVisited = visitedCount;
+    solution.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    _visited.clear();
+    return solution;
+}
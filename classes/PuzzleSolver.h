@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// the rules interface a single player puzzle implements to be solved
+// positions are packed into 64 bits so millions of them fit in the visited set,
+// and a move includes whatever the puzzle does in reply (enemies moving, etc)
+//
+class PuzzleRules
+{
+public:
+    virtual ~PuzzleRules() {}
+
+    virtual uint64_t initialState() const = 0;
+    // fill in (move, next state) for every move that doesn't lose on the spot
+    virtual void successors(uint64_t state, std::vector<std::pair<int, uint64_t>> &next) const = 0;
+    virtual bool isGoal(uint64_t state) const = 0;
+    // lower bound on the moves left, for A*. 0 turns A* into uniform cost search
+    virtual int heuristic(uint64_t state) const { return 0; }
+};
+
+//
+// breadth first and A* search over a puzzle's state space
+// breadth first search expands each level of the frontier in parallel on the
+// shared thread pool, with the visited set sharded so the merge is parallel too
+//
+class PuzzleSolver
+{
+public:
+    struct Config {
+        int threads = 0;                    // 0 uses the whole pool
+        size_t maxStates = 1 << 24;         // give up past this many visited states
+        size_t parallelFrontier = 512;      // smaller levels are expanded on the calling thread
+    };
+
+    struct Solution {
+        bool solved = false;
+        std::vector<int> moves;             // shortest solution, empty if already solved
+        size_t statesVisited = 0;
+        double milliseconds = 0.0;
+    };
+
+    explicit PuzzleSolver(const PuzzleRules &rules);
+
+    Config &config() { return _config; }
+
+    Solution solveBFS();
+    Solution solveAStar();
+
+private:
+    static const int ShardCount = 64;
+
+    struct Visit {
+        uint64_t parent;
+        int move;
+        int depth;
+    };
+    typedef std::unordered_map<uint64_t, Visit> VisitedSet;
+
+    struct Candidate {
+        uint64_t state;
+        uint64_t parent;
+        int move;
+    };
+
+    static int shardOf(uint64_t state);
+    void expand(const std::vector<uint64_t> &frontier, size_t begin, size_t end, std::vector<Candidate> &out) const;
+    void merge(int shard, int depth, const std::vector<std::vector<Candidate>> &candidates, std::vector<uint64_t> &next, uint64_t &goal, bool &found);
+    Visit *findVisit(uint64_t state);
+    void traceBack(uint64_t goal, Solution &solution);
+
+    const PuzzleRules &_rules;
+    Config _config;
+    std::vector<VisitedSet> _visited;
+};
@@ -0,0 +1,115 @@
+#include "ResourcePack.h"
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ResourcePack &ResourcePack::instance()
+{
+    static ResourcePack pack;
+    static std::once_flag opened;
+    std::call_once(opened, []() { pack.open("resources/resources.pack"); });
+    return pack;
+}
+
+ResourcePack::~ResourcePack()
+{
+    close();
+}
+
+bool ResourcePack::open(const char *path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = GetFileSizeEx(file, &size) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    _file = file;
+    _mapping = mapping;
+    _size = (size_t)size.QuadPart;
+#else
+    int file = ::open(path, O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat info;
+    void *view = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    // the mapping keeps the file alive on its own
+    ::close(file);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    _size = (size_t)info.st_size;
+#endif
+    _data = static_cast<const unsigned char *>(view);
+
+    // a pack from another version, or a truncated one, is as good as none
+    const Header *header = reinterpret_cast<const Header *>(_data);
+    if (_size < sizeof(Header) || std::memcmp(header->magic, "CGPK", 4) != 0 || header->version != Version ||
+        header->count > (_size - sizeof(Header)) / sizeof(Entry)) {
+        close();
+        return false;
+    }
+    const Entry *entries = reinterpret_cast<const Entry *>(_data + sizeof(Header));
+    for (uint32_t i = 0; i < header->count; i++) {
+        const Entry &entry = entries[i];
+        uint64_t bytes = (uint64_t)entry.width * entry.height * 4;
+        if (entry.name[NameLength - 1] != 0 || entry.offset > _size || bytes > _size - entry.offset) {
+            close();
+            return false;
+        }
+        _index[entry.name] = &entry;
+    }
+    return true;
+}
+
+void ResourcePack::close()
+{
+    _index.clear();
+    if (!_data) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(_data);
+    CloseHandle(static_cast<HANDLE>(_mapping));
+    CloseHandle(static_cast<HANDLE>(_file));
+    _file = nullptr;
+    _mapping = nullptr;
+#else
+    munmap(const_cast<unsigned char *>(_data), _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+const unsigned char *ResourcePack::find(const char *name, int &width, int &height) const
+{
+    auto found = _index.find(name);
+    if (found == _index.end()) {
+        return nullptr;
+    }
+    width = (int)found->second->width;
+    height = (int)found->second->height;
+    return _data + found->second->offset;
+}
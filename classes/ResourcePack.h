@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+//
+// every image in resources/, decoded to RGBA once at build time (tools/packresources)
+// and written to a single file: a header, an index of entries, then the pixels.
+// the game maps the file at startup and hands the pixels straight to the texture
+// upload, so loading a sprite reads no PNG and decodes nothing. an image missing
+// from the pack (or no pack at all) falls back to decoding the PNG as before
+//
+class ResourcePack
+{
+public:
+    static const uint32_t Version = 1;
+    static const size_t NameLength = 48;
+
+    struct Header
+    {
+        char magic[4];          // "CGPK"
+        uint32_t version;
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    struct Entry
+    {
+        char name[NameLength];  // file name in resources/, nul terminated
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;        // of the width * height * 4 bytes of pixels, from the start of the file
+    };
+
+    // resources/resources.pack, mapped on first use
+    static ResourcePack &instance();
+
+    ResourcePack() : _data(nullptr), _size(0), _file(nullptr), _mapping(nullptr) {}
+    ~ResourcePack();
+    ResourcePack(const ResourcePack &) = delete;
+    ResourcePack &operator=(const ResourcePack &) = delete;
+
+    bool open(const char *path);
+    void close();
+    bool isOpen() const { return _data != nullptr; }
+
+    // the packed pixels of an image, or nullptr if the pack doesn't have it
+    const unsigned char *find(const char *name, int &width, int &height) const;
+
+private:
+    const unsigned char *_data;
+    size_t _size;
+    void *_file;                // platform handles, only used on Windows
+    void *_mapping;
+    std::unordered_map<std::string, const Entry *> _index;
+};
@@ -0,0 +1,52 @@
+#include "SpatialHash.h"
+#include <cmath>
+
+void SpatialHash::setCellSize(float cellSize)
+{
+    if (cellSize > 0.0f && cellSize != _cellSize) {
+        _cellSize = cellSize;
+        _cells.clear();
+        _count = 0;
+    }
+}
+
+void SpatialHash::clear()
+{
+    if (_count == 0) return;
+    for (auto &cell : _cells) {
+        cell.second.clear();
+    }
+    _count = 0;
+}
+
+int SpatialHash::cellOf(float coordinate) const
+{
+    return (int)std::floor(coordinate / _cellSize);
+}
+
+void SpatialHash::insert(Sprite *sprite)
+{
+    const ImVec2 &location = sprite->getPosition();
+    const ImVec2 &size = sprite->getSize();
+    int x0 = cellOf(location.x);
+    int y0 = cellOf(location.y);
+    int x1 = cellOf(location.x + size.x);
+    int y1 = cellOf(location.y + size.y);
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            _cells[cellKey(x, y)].push_back(sprite);
+        }
+    }
+    _count++;
+}
+
+Sprite *SpatialHash::spriteAt(const ImVec2 &point) const
+{
+    if (_count == 0) return nullptr;
+    auto cell = _cells.find(cellKey(cellOf(point.x), cellOf(point.y)));
+    if (cell == _cells.end()) return nullptr;
+    for (auto sprite = cell->second.rbegin(); sprite != cell->second.rend(); ++sprite) {
+        if ((*sprite)->isMouseOver(point)) return *sprite;
+    }
+    return nullptr;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Sprite.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//
+// a uniform bucket grid of sprites for point hit-testing
+// each sprite goes into every cell its rectangle overlaps, so a query only
+// tests the sprites in one cell. meant for the few sprites that don't sit on
+// the board lattice (moving or dragged pieces), rebuilt every frame; clear()
+// keeps the buckets so the rebuild doesn't allocate once it has warmed up
+//
+class SpatialHash
+{
+public:
+    explicit SpatialHash(float cellSize = 80.0f) : _cellSize(cellSize), _count(0) {}
+
+    void setCellSize(float cellSize);
+    void clear();
+    void insert(Sprite *sprite);
+    // the last inserted sprite under the point, or nullptr
+    Sprite *spriteAt(const ImVec2 &point) const;
+    bool empty() const { return _count == 0; }
+
+private:
+    int64_t cellKey(int x, int y) const { return ((int64_t)x << 32) ^ (uint32_t)y; }
+    int cellOf(float coordinate) const;
+
+    float _cellSize;
+    size_t _count;
+    std::unordered_map<int64_t, std::vector<Sprite *>> _cells;
+};
@@ -1,47 +1,156 @@
 #include "Sprite.h"
+#include "ResourcePack.h"
+#include "PerfStats.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 // Simple helper function to load an image into a OpenGL texture with common settings
 bool Sprite::LoadTextureFromFile(const char* filename)
 {
-    // Load from file
+    ImVec2 size(0, 0);
+    ImTextureID texture = loadTexture(filename, size);
+    if (texture == 0) {
+        setSize(0, 0);
+        return false;
+    }
+    setTexture(texture, size);
+    return true;
+}
+
+ImTextureID Sprite::loadTexture(const char* filename, ImVec2 &size)
+{
+    // every piece of a kind shares one texture, decoded and uploaded the first time only,
+    // so recycled bits don't pile up a new texture each move
+    static std::mutex loadedLock;
+    static std::unordered_map<std::string, std::pair<ImTextureID, ImVec2>> loaded;
+    std::lock_guard<std::mutex> lock(loadedLock);
+    auto found = loaded.find(filename);
+    if (found != loaded.end()) {
+        size = found->second.second;
+        return found->second.first;
+    }
+
+    // the build packs every resource already decoded, so normally there's nothing to decode
     int image_width = 0;
     int image_height = 0;
-    std::filesystem::path resourcePath = std::filesystem::path("resources") / filename;
-    std::string newFilename = resourcePath.string();
-    unsigned char* image_data = stbi_load(newFilename.c_str(), &image_width, &image_height, NULL, 4);
-    if (image_data == NULL) {
-        _size = ImVec2(0, 0);
-        std::cout << "Failed to load texture: " << newFilename << std::endl;
-        return false;
+    ImTextureID texture = 0;
+    const unsigned char* packed = ResourcePack::instance().find(filename, image_width, image_height);
+    if (packed) {
+        texture = _loadTextureFromMemory(packed, image_width, image_height);
+    } else {
+        // Load from file
+        std::filesystem::path resourcePath = std::filesystem::path("resources") / filename;
+        std::string newFilename = resourcePath.string();
+        unsigned char* image_data = stbi_load(newFilename.c_str(), &image_width, &image_height, NULL, 4);
+        if (image_data == NULL) {
+            std::cout << "Failed to load texture: " << newFilename << std::endl;
+            return 0;
+        }
+        texture = _loadTextureFromMemory(image_data, image_width, image_height);
+        if (texture != 0) {
+            SpriteStore::setTexturePixels(texture, image_width, image_height, image_data);
+        }
+        stbi_image_free(image_data);
     }
-    _texture = _loadTextureFromMemory(image_data, image_width, image_height);
-    stbi_image_free(image_data);
-    if (_texture == 0) {
-        _size = ImVec2(0, 0);
-        return false;
+    if (texture == 0) {
+        return 0;
     }
-    _size = ImVec2((float)image_width, (float)image_height);
-    return true;
+    // keep the pixels too, boards bake their squares from them
+    if (packed) {
+        SpriteStore::setTexturePixels(texture, image_width, image_height, packed);
+    }
+    size = ImVec2((float)image_width, (float)image_height);
+    loaded[filename] = std::make_pair(texture, size);
+    return texture;
 }
 
 void Sprite::setHighlighted(bool highlighted)
 {
-	if (highlighted != _highlighted) {
-		_highlighted = highlighted;
-	}
+	setFlag(SpriteStore::Highlighted, highlighted);
 }
 
 bool Sprite::highlighted()
 {
-	return _highlighted;
+	return hasFlag(SpriteStore::Highlighted);
+}
+
+namespace
+{
+    struct MipLevel
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    //
+    // the image halved again and again down to 1x1 with a 2x2 box filter, the levels
+    // after the first (which is the image itself and isn't copied). colour is weighted
+    // by alpha, otherwise the transparent texels around a piece darken its edge when small
+    //
+    std::vector<MipLevel> buildMipChain(const unsigned char *image_data, int image_width, int image_height)
+    {
+        std::vector<MipLevel> chain;
+        const unsigned char *src = image_data;
+        int width = image_width;
+        int height = image_height;
+        while (width > 1 || height > 1) {
+            MipLevel level{std::max(1, width / 2), std::max(1, height / 2), {}};
+            level.pixels.resize((size_t)level.width * level.height * 4);
+            for (int y = 0; y < level.height; y++) {
+                for (int x = 0; x < level.width; x++) {
+                    int x0 = x * 2, x1 = std::min(x * 2 + 1, width - 1);
+                    int y0 = y * 2, y1 = std::min(y * 2 + 1, height - 1);
+                    const unsigned char *texels[4] = {
+                        src + ((size_t)y0 * width + x0) * 4, src + ((size_t)y0 * width + x1) * 4,
+                        src + ((size_t)y1 * width + x0) * 4, src + ((size_t)y1 * width + x1) * 4};
+                    int alpha = 0;
+                    int colour[3] = {0, 0, 0};
+                    for (const unsigned char *texel : texels) {
+                        alpha += texel[3];
+                        for (int c = 0; c < 3; c++) colour[c] += texel[c] * texel[3];
+                    }
+                    unsigned char *dst = &level.pixels[((size_t)y * level.width + x) * 4];
+                    for (int c = 0; c < 3; c++) {
+                        dst[c] = alpha > 0 ? (unsigned char)((colour[c] + alpha / 2) / alpha) : 0;
+                    }
+                    dst[3] = (unsigned char)((alpha + 2) / 4);
+                }
+            }
+            chain.push_back(std::move(level));
+            src = chain.back().pixels.data();
+            width = chain.back().width;
+            height = chain.back().height;
+        }
+        return chain;
+    }
+
+    // the memory a texture takes on the GPU side, all levels
+    size_t textureBytes(int image_width, int image_height, const std::vector<MipLevel> &mips)
+    {
+        size_t bytes = (size_t)image_width * image_height * 4;
+        for (const MipLevel &level : mips) {
+            bytes += level.pixels.size();
+        }
+        return bytes;
+    }
 }
 
-#ifdef __APPLE__
+#ifndef _WIN32
 #include "../imgui/imgui_impl_opengl3_loader.h"
+#ifndef GL_LINEAR_MIPMAP_LINEAR
+#define GL_LINEAR_MIPMAP_LINEAR 0x2703
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
 
 ImTextureID Sprite::_loadTextureFromMemory(const unsigned char *image_data, int image_width, int image_height)
 {
@@ -51,15 +160,30 @@ ImTextureID Sprite::_loadTextureFromMemory(const unsigned char *image_data, int
     glBindTexture(GL_TEXTURE_2D, image_texture);
 
     // Setup filtering parameters for display
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // GL picks the mip level for the size drawn by itself
+    std::vector<MipLevel> mips = buildMipChain(image_data, image_width, image_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)mips.size());
 
     // Upload pixels into texture
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_width, image_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+    for (size_t i = 0; i < mips.size(); i++) {
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i + 1, GL_RGBA, mips[i].width, mips[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mips[i].pixels.data());
+    }
+    PerfStats::textureCreated(static_cast<ImTextureID>(image_texture), textureBytes(image_width, image_height, mips));
 
     return static_cast<ImTextureID>(image_texture);
 }
 
+void Sprite::releaseTexture(ImTextureID texture)
+{
+    PerfStats::textureReleased(texture);
+    SpriteStore::forgetTexture(texture);
+    GLuint image_texture = (GLuint)texture;
+    glDeleteTextures(1, &image_texture);
+}
+
 #else
 
 // DirectX
@@ -72,12 +196,13 @@ ImTextureID Sprite::_loadTextureFromMemory(const unsigned char *image_data, int
 
 ImTextureID Sprite::_loadTextureFromMemory(const unsigned char *image_data, int image_width, int image_height)
 {
-    // Create texture
+    // Create texture, with its mip levels
+    std::vector<MipLevel> mips = buildMipChain(image_data, image_width, image_height);
     D3D11_TEXTURE2D_DESC desc;
     ZeroMemory(&desc, sizeof(desc));
     desc.Width = image_width;
     desc.Height = image_height;
-    desc.MipLevels = 1;
+    desc.MipLevels = (UINT)mips.size() + 1;
     desc.ArraySize = 1;
     desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
     desc.SampleDesc.Count = 1;
@@ -86,36 +211,65 @@ ImTextureID Sprite::_loadTextureFromMemory(const unsigned char *image_data, int
     desc.CPUAccessFlags = 0;
 
     ID3D11Texture2D *pTexture = NULL;
-    D3D11_SUBRESOURCE_DATA subResource;
-    subResource.pSysMem = image_data;
-    subResource.SysMemPitch = desc.Width * 4;
-    subResource.SysMemSlicePitch = 0;
+    std::vector<D3D11_SUBRESOURCE_DATA> subResources(desc.MipLevels);
+    subResources[0].pSysMem = image_data;
+    subResources[0].SysMemPitch = desc.Width * 4;
+    subResources[0].SysMemSlicePitch = 0;
+    for (size_t i = 0; i < mips.size(); i++) {
+        subResources[i + 1].pSysMem = mips[i].pixels.data();
+        subResources[i + 1].SysMemPitch = mips[i].width * 4;
+        subResources[i + 1].SysMemSlicePitch = 0;
+    }
 
     // You need to have a valid ID3D11Device* available as g_pd3dDevice
     extern ID3D11Device* g_pd3dDevice; // Add this line if g_pd3dDevice is defined elsewhere
 
-    HRESULT hr = g_pd3dDevice->CreateTexture2D(&desc, &subResource, &pTexture);
+    HRESULT hr = g_pd3dDevice->CreateTexture2D(&desc, subResources.data(), &pTexture);
     if (FAILED(hr) || !pTexture) {
         return 0;
     }
 
     // Create texture view
-    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-    ZeroMemory(&srvDesc, sizeof(srvDesc));
-    srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MipLevels = desc.MipLevels;
-    srvDesc.Texture2D.MostDetailedMip = 0;
-
-    ID3D11ShaderResourceView* shaderResourceView = nullptr;
-    hr = g_pd3dDevice->CreateShaderResourceView(pTexture, &srvDesc, &shaderResourceView);
+    // imgui's sampler only reads the most detailed level of a view, so each level gets
+    // a view of its own and SpriteStore::paint picks one for the size drawn
+    std::vector<ImTextureID> levels;
+    for (UINT level = 0; level < desc.MipLevels; level++) {
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        ZeroMemory(&srvDesc, sizeof(srvDesc));
+        srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = 1;
+        srvDesc.Texture2D.MostDetailedMip = level;
+
+        ID3D11ShaderResourceView* shaderResourceView = nullptr;
+        hr = g_pd3dDevice->CreateShaderResourceView(pTexture, &srvDesc, &shaderResourceView);
+        if (FAILED(hr) || !shaderResourceView) {
+            break;
+        }
+        levels.push_back(reinterpret_cast<ImTextureID>(shaderResourceView));
+    }
     pTexture->Release();
 
-    if (FAILED(hr) || !shaderResourceView) {
+    if (levels.empty()) {
 
         return 0;
     }
-    return reinterpret_cast<ImTextureID>(shaderResourceView);
+    SpriteStore::setTextureLevels(levels[0], ImVec2((float)image_width, (float)image_height), levels);
+    PerfStats::textureCreated(levels[0], textureBytes(image_width, image_height, mips));
+    return levels[0];
+}
+
+void Sprite::releaseTexture(ImTextureID texture)
+{
+    PerfStats::textureReleased(texture);
+    // the view of each level holds the texture, the last release frees it
+    std::vector<ImTextureID> levels = SpriteStore::forgetTexture(texture);
+    if (levels.empty()) {
+        levels.push_back(texture);
+    }
+    for (ImTextureID level : levels) {
+        reinterpret_cast<ID3D11ShaderResourceView*>(level)->Release();
+    }
 }
 #endif
 
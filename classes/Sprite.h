@@ -1,81 +1,102 @@
 #pragma once
 #include "Entity.h"
 #include "../imgui/imgui.h"
+#include "SpriteStore.h"
 
 class Sprite : public Entity
 {
     // sprite contains code for a simple OpenGL sprite class that is heirarchical, and can be used to draw a sprite with a texture
     // it is not intended to be a full-featured sprite class, but rather a simple one that can be used for simple games
+    // the drawing state itself lives in the thread's SpriteStore, a sprite is its handle there
 
 public:
     Sprite() : 
         _parent(nullptr),
-        _location(0, 0),
-        _size(0,0),
-        _rotation(0), 
-        _scale(1),
-        _color(1, 1, 1, 1),
-        _localZOrder(0),
-        _highlighted(false)
+        _store(&SpriteStore::local())
         { 
             _entityType = EntitySprite;
+            _handle = _store->create(this);
         };
-    ~Sprite() { if (_retainCount > 0) release(); }
+    ~Sprite()
+    {
+        if (_retainCount > 0) release();
+        _store->destroy(_handle);
+    }
+    // a handle can't be shared
+    Sprite(const Sprite &) = delete;
+    Sprite &operator=(const Sprite &) = delete;
     
     // set the texture to use for this sprite
     void setPosition(float x, float y)
     {
-        _location = ImVec2(x, y);
+        _store->positions[_handle] = ImVec2(x, y);
     }
     void setPosition(const ImVec2 &point)
     {
-        _location = point;
+        _store->positions[_handle] = point;
     }
     void setCenterPosition(const ImVec2 &point)
     {
-        _location = ImVec2(point.x - _size.x / 2, point.y - _size.y / 2);
+        const ImVec2 &size = _store->sizes[_handle];
+        _store->positions[_handle] = ImVec2(point.x - size.x / 2, point.y - size.y / 2);
     }
-    const ImVec2 &getPosition() { return _location; }
+    ImVec2 getPosition() const { return _store->positions[_handle]; }
 
     void setSize(float x, float y)
     {
-        _size = ImVec2(x, y);
+        _store->sizes[_handle] = ImVec2(x, y);
     }
+    ImVec2 getSize() const { return _store->sizes[_handle]; }
     // set the rotation of the sprite
-    void setRotation(float rotation) { _rotation = rotation; }
+    void setRotation(float rotation) { _store->rotations[_handle] = rotation; }
     // set the scale of the sprite
-    void setScale(float scale) { _scale = scale; }
+    void setScale(float scale) { _store->scales[_handle] = scale; }
     // set the color of the sprite
     void setColor(float r, float g, float b, float a)
     {
-        _color = ImVec4(r, g, b, a);
+        _store->colors[_handle] = ImVec4(r, g, b, a);
     }
-    void setColor(const ImVec4 &color) { _color = color; }
+    void setColor(const ImVec4 &color) { _store->colors[_handle] = color; }
+    ImVec4 getColor() const { return _store->colors[_handle]; }
     // set my Z order
-    void setLocalZOrder(int localZOrder) { _localZOrder = localZOrder; }
+    void setLocalZOrder(int localZOrder) { _store->zOrders[_handle] = localZOrder; }
     // get my Z order
-    int getLocalZOrder() { return _localZOrder; }
+    int getLocalZOrder() { return _store->zOrders[_handle]; }
     // get rotation
-    float getRotation() { return _rotation; }
+    float getRotation() { return _store->rotations[_handle]; }
     // moveTo
-    void moveTo(const ImVec2 &point) { _location = point; }
+    void moveTo(const ImVec2 &point) { _store->positions[_handle] = point; }
     // draw the sprite
-    void paintSprite()
-    {
-        if (_size.x > 0.0f && _size.y > 0.0f) 
-        {
-            ImGui::SetCursorPos(_location);
-            ImVec4 highlight = _highlighted ? ImVec4(1, 1, 0, 1) : ImVec4(0, 0, 0, 0);
-            ImGui::Image((void*)(intptr_t)_texture, _size, ImVec2(0, 0), ImVec2(1, 1), _color, highlight);
-        }
-    }
+    void paintSprite() { _store->paint(_handle); }
 	// is the mouse over this position?
 	bool isMouseOver(const ImVec2 &mousePos)
     {
-        return (mousePos.x >= _location.x && mousePos.x <= _location.x + _size.x && mousePos.y >= _location.y && mousePos.y <= _location.y + _size.y);
+        const ImVec2 &location = _store->positions[_handle];
+        const ImVec2 &size = _store->sizes[_handle];
+        return (mousePos.x >= location.x && mousePos.x <= location.x + size.x && mousePos.y >= location.y && mousePos.y <= location.y + size.y);
     }
 
     bool LoadTextureFromFile(const char* filename);
+    // the shared texture for a file in resources/, loaded the first time, 0 if it can't be
+    static ImTextureID loadTexture(const char* filename, ImVec2 &size);
+    // upload RGBA pixels that aren't from a file (a baked board), and free such a texture
+    static ImTextureID createTexture(const unsigned char *pixels, int width, int height)
+    {
+        return _loadTextureFromMemory(pixels, width, height);
+    }
+    static void releaseTexture(ImTextureID texture);
+    // share a texture that is already loaded, no decode or upload
+    ImTextureID getTexture() const { return _store->textures[_handle]; }
+    void setTexture(ImTextureID texture, const ImVec2 &size)
+    {
+        _store->setTexture(_handle, texture);
+        _store->sizes[_handle] = size;
+    }
+
+    // which board the sprite is drawn with, and whether it is drawn at all
+    int getGroup() const { return _store->groups[_handle]; }
+    void setGroup(int group) { _store->setGroup(_handle, group); }
+    void setVisible(bool visible) { setFlag(SpriteStore::Hidden, !visible); }
 	
     // set the highlighted state
 	virtual void	setHighlighted(bool yes);
@@ -84,26 +105,18 @@ public:
 	bool	highlighted();
 
 protected:
-    // the texture to use for this sprite
-    // GLuint _texture;
+    bool hasFlag(uint16_t flag) const { return (_store->flags[_handle] & flag) != 0; }
+    void setFlag(uint16_t flag, bool on)
+    {
+        uint16_t &flags = _store->flags[_handle];
+        flags = on ? (flags | flag) : (flags & ~flag);
+    }
+
     // the parent of this sprite
     Sprite *_parent;
-    // the position of the sprite
-    ImVec2  _location;
-    // the size of the sprite
-    ImVec2 _size;
-    // the rotation of the sprite
-    float _rotation;
-    // the scale of the sprite
-    float _scale;
-    // the color of the sprite
-    ImVec4  _color;
-    // the local Z order
-    int _localZOrder;
-    // the texture we're going to draw
-    ImTextureID _texture;
-    // currently highlighted
-   	bool	_highlighted;
+    // where the drawing state lives, and our row there
+    SpriteStore *_store;
+    SpriteStore::Handle _handle;
     // private platform specific texture loading
-    ImTextureID _loadTextureFromMemory(const unsigned char *image_data, int image_width, int image_height);
+    static ImTextureID _loadTextureFromMemory(const unsigned char *image_data, int image_width, int image_height);
 };
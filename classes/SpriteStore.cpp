@@ -0,0 +1,270 @@
+#include "SpriteStore.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+
+SpriteStore &SpriteStore::local()
+{
+    thread_local SpriteStore store;
+    return store;
+}
+
+int SpriteStore::newGroup()
+{
+    static std::atomic<int> nextGroup(1);
+    return nextGroup++;
+}
+
+SpriteStore::Handle SpriteStore::create(Sprite *owner)
+{
+    Handle handle;
+    if (!_free.empty()) {
+        handle = _free.back();
+        _free.pop_back();
+    } else {
+        handle = (Handle)flags.size();
+        flags.push_back(0);
+        groups.push_back(0);
+        owners.push_back(nullptr);
+        positions.emplace_back(0, 0);
+        sizes.emplace_back(0, 0);
+        colors.emplace_back(1, 1, 1, 1);
+        textures.push_back(0);
+        levels.emplace_back();
+        rotations.push_back(0);
+        scales.push_back(1);
+        zOrders.push_back(0);
+    }
+    flags[handle] = Live;
+    groups[handle] = 0;
+    owners[handle] = owner;
+    positions[handle] = ImVec2(0, 0);
+    sizes[handle] = ImVec2(0, 0);
+    colors[handle] = ImVec4(1, 1, 1, 1);
+    textures[handle] = 0;
+    levels[handle] = nullptr;
+    rotations[handle] = 0;
+    scales[handle] = 1;
+    zOrders[handle] = 0;
+    return handle;
+}
+
+void SpriteStore::destroy(Handle handle)
+{
+    if (flags[handle] & (Moving | Flipping)) {
+        for (size_t i = _tweens.size(); i-- > 0;) {
+            if (_tweens[i].handle == handle) {
+                _tweens[i] = std::move(_tweens.back());
+                _tweens.pop_back();
+            }
+        }
+    }
+    setGroup(handle, 0);
+    flags[handle] = 0;
+    owners[handle] = nullptr;
+    levels[handle] = nullptr;
+    _free.push_back(handle);
+}
+
+void SpriteStore::setTexture(Handle handle, ImTextureID texture)
+{
+    textures[handle] = texture;
+    levels[handle] = findLevels(texture);
+}
+
+void SpriteStore::setGroup(Handle handle, int group)
+{
+    int old = groups[handle];
+    if (old == group) return;
+    if (old != 0) {
+        std::vector<Handle> &members = _members[old];
+        members.erase(std::lower_bound(members.begin(), members.end(), handle));
+        if (members.empty()) {
+            _members.erase(old);
+        }
+    }
+    if (group != 0) {
+        std::vector<Handle> &members = _members[group];
+        members.insert(std::lower_bound(members.begin(), members.end(), handle), handle);
+    }
+    groups[handle] = group;
+}
+
+double SpriteStore::now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SpriteStore::startMove(Handle handle, const ImVec2 &to, float seconds, Done done)
+{
+    if (flags[handle] & Moving) {
+        for (Tween &tween : _tweens) {
+            if (tween.handle == handle && tween.kind == Moving) {
+                tween.from = positions[handle];
+                tween.to = to;
+                tween.start = now();
+                tween.seconds = seconds;
+                tween.done = std::move(done);
+                return;
+            }
+        }
+    }
+    _tweens.push_back(Tween{handle, Moving, now(), seconds, positions[handle], to, 0, nullptr, std::move(done)});
+    flags[handle] |= Moving;
+}
+
+void SpriteStore::startFlip(Handle handle, ImTextureID face, float seconds, Done done)
+{
+    finish(handle);
+    _tweens.push_back(Tween{handle, Flipping, now(), seconds, positions[handle], sizes[handle], face, findLevels(face), std::move(done)});
+    flags[handle] |= Flipping;
+}
+
+void SpriteStore::finish(Handle handle)
+{
+    if (!(flags[handle] & (Moving | Flipping))) return;
+    for (size_t i = _tweens.size(); i-- > 0;) {
+        if (_tweens[i].handle == handle) {
+            apply(_tweens[i], 1.0f);
+            retireTween(i);
+        }
+    }
+    std::vector<Done> finished;
+    finished.swap(_finished);
+    for (Done &done : finished) done();
+}
+
+void SpriteStore::apply(Tween &tween, float progress)
+{
+    Handle handle = tween.handle;
+    if (tween.kind == Moving) {
+        positions[handle] = ImVec2(tween.from.x + (tween.to.x - tween.from.x) * progress, tween.from.y + (tween.to.y - tween.from.y) * progress);
+        return;
+    }
+    // narrow to nothing, swap the face at the halfway point, then widen again
+    if (progress >= 0.5f && textures[handle] != tween.face) {
+        textures[handle] = tween.face;
+        levels[handle] = tween.faceLevels;
+    }
+    float width = tween.to.x * std::fabs(1.0f - 2.0f * progress);
+    sizes[handle] = ImVec2(width, tween.to.y);
+    positions[handle] = ImVec2(tween.from.x + (tween.to.x - width) / 2, tween.from.y);
+}
+
+void SpriteStore::retireTween(size_t index)
+{
+    Tween &tween = _tweens[index];
+    flags[tween.handle] &= ~tween.kind;
+    if (tween.done) {
+        _finished.push_back(std::move(tween.done));
+    }
+    _tweens[index] = std::move(_tweens.back());
+    _tweens.pop_back();
+}
+
+void SpriteStore::advance()
+{
+    if (_tweens.empty()) return;
+    double time = now();
+    for (size_t i = 0; i < _tweens.size();) {
+        Tween &tween = _tweens[i];
+        float progress = tween.seconds > 0.0f ? (float)std::min(1.0, (time - tween.start) / tween.seconds) : 1.0f;
+        apply(tween, progress);
+        if (progress >= 1.0f) {
+            retireTween(i);
+        } else {
+            i++;
+        }
+    }
+    // after the sweep, a callback may well start the next animation
+    std::vector<Done> finished;
+    finished.swap(_finished);
+    for (Done &done : finished) done();
+}
+
+namespace
+{
+    // textures are shared by every thread's store, and loaded from any of them
+    struct TextureInfo
+    {
+        // shared with the sprites drawing the texture, replaced rather than changed
+        std::shared_ptr<const SpriteStore::TextureLevels> levels;
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+    };
+    std::mutex texturesLock;
+    std::unordered_map<ImTextureID, TextureInfo> textureInfo;
+}
+
+void SpriteStore::setTextureLevels(ImTextureID texture, const ImVec2 &size, const std::vector<ImTextureID> &levels)
+{
+    std::lock_guard<std::mutex> lock(texturesLock);
+    textureInfo[texture].levels = std::make_shared<const TextureLevels>(TextureLevels{size, levels});
+}
+
+void SpriteStore::setTexturePixels(ImTextureID texture, int width, int height, const unsigned char *pixels)
+{
+    std::lock_guard<std::mutex> lock(texturesLock);
+    TextureInfo &info = textureInfo[texture];
+    info.width = width;
+    info.height = height;
+    info.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+}
+
+const unsigned char *SpriteStore::texturePixels(ImTextureID texture, int &width, int &height)
+{
+    std::lock_guard<std::mutex> lock(texturesLock);
+    auto found = textureInfo.find(texture);
+    if (found == textureInfo.end() || found->second.pixels.empty()) return nullptr;
+    width = found->second.width;
+    height = found->second.height;
+    return found->second.pixels.data();
+}
+
+std::vector<ImTextureID> SpriteStore::forgetTexture(ImTextureID texture)
+{
+    std::lock_guard<std::mutex> lock(texturesLock);
+    std::vector<ImTextureID> levels;
+    auto found = textureInfo.find(texture);
+    if (found != textureInfo.end()) {
+        if (found->second.levels) {
+            levels = found->second.levels->levels;
+        }
+        textureInfo.erase(found);
+    }
+    return levels;
+}
+
+std::shared_ptr<const SpriteStore::TextureLevels> SpriteStore::findLevels(ImTextureID texture)
+{
+    std::lock_guard<std::mutex> lock(texturesLock);
+    auto found = textureInfo.find(texture);
+    return found != textureInfo.end() ? found->second.levels : nullptr;
+}
+
+ImTextureID SpriteStore::textureForSize(ImTextureID texture, const TextureLevels *levels, const ImVec2 &size)
+{
+    if (!levels || levels->levels.empty()) return texture;
+    // judge by the less shrunk side, so a flip squeezing the width keeps its detail
+    float shrink = std::min(levels->size.x / size.x, levels->size.y / size.y);
+    int level = 0;
+    while (shrink >= 2.0f && level + 1 < (int)levels->levels.size()) {
+        shrink /= 2.0f;
+        level++;
+    }
+    return levels->levels[level];
+}
+
+void SpriteStore::paint(Handle handle) const
+{
+    const ImVec2 &size = sizes[handle];
+    if (size.x > 0.0f && size.y > 0.0f) {
+        ImGui::SetCursorPos(positions[handle]);
+        ImVec4 highlight = (flags[handle] & Highlighted) ? ImVec4(1, 1, 0, 1) : ImVec4(0, 0, 0, 0);
+        ImGui::Image(textureForSize(textures[handle], levels[handle].get(), size), size, ImVec2(0, 0), ImVec2(1, 1), colors[handle], highlight);
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "../imgui/imgui.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Sprite;
+
+//
+// every sprite's drawing and animation state, kept as a structure of arrays
+// a Sprite is a handle into one of these; its position, size, texture and so on
+// live in contiguous columns, so animating and painting a board are linear
+// sweeps over those columns instead of pointer chasing through the squares.
+//
+// each thread has its own store (boards simulated on a worker never touch the
+// one being drawn), and sprites are grouped by board so a frame only paints its own.
+// each group keeps a list of its handles, so sweeping a board never visits another's
+//
+// animations are tweens on a list of their own: only running ones get any work,
+// and they run on the clock, so a move takes as long at 30 Hz as at 144 Hz
+//
+class SpriteStore
+{
+public:
+    typedef uint32_t Handle;
+
+    enum Flags : uint16_t
+    {
+        Live = 1 << 0,
+        Hidden = 1 << 1,
+        Piece = 1 << 2,         // a Bit, painted above the squares
+        Moving = 1 << 3,
+        Flipping = 1 << 4,
+        PickedUp = 1 << 5,
+        Highlighted = 1 << 6
+    };
+
+    // the calling thread's store
+    static SpriteStore &local();
+    // a fresh group id for a board's sprites
+    static int newGroup();
+
+    Handle create(Sprite *owner);
+    // a destroyed sprite's tweens are dropped without calling their done callbacks
+    void destroy(Handle handle);
+    // draw the sprite with a texture, looking up its mip levels once here rather than every paint
+    void setTexture(Handle handle, ImTextureID texture);
+    // move a sprite to a board's group, 0 for none
+    void setGroup(Handle handle, int group);
+
+    typedef std::function<void()> Done;
+    // slide to a point, replacing any move already running
+    void startMove(Handle handle, const ImVec2 &to, float seconds, Done done = nullptr);
+    // squeeze to the edge, show the new face, open again
+    void startFlip(Handle handle, ImTextureID face, float seconds, Done done = nullptr);
+    // jump the sprite's tweens to their end, as if they had run out
+    void finish(Handle handle);
+    // bring every running tween up to now, then call done for the ones that finished
+    // cheap to call more than once a frame, progress comes from the clock
+    void advance();
+    size_t activeTweens() const { return _tweens.size(); }
+    static double now();
+
+    void paint(Handle handle) const;
+
+    // a texture's mip levels as textures of their own, for backends whose sampler only
+    // ever reads the top level. level 0 is the texture itself and each level halves it;
+    // paint draws a sprite with the smallest level still as big as it is on screen, so
+    // a small board samples a small image instead of minifying the full one
+    struct TextureLevels
+    {
+        ImVec2 size;
+        std::vector<ImTextureID> levels;
+    };
+    static void setTextureLevels(ImTextureID texture, const ImVec2 &size, const std::vector<ImTextureID> &levels);
+    // a copy of a texture's pixels on the CPU side, for baking boards (see BoardBackground)
+    static void setTexturePixels(ImTextureID texture, int width, int height, const unsigned char *pixels);
+    // the RGBA pixels kept for a texture, or nullptr
+    static const unsigned char *texturePixels(ImTextureID texture, int &width, int &height);
+    // drop what is kept for a texture being freed, returning its level textures
+    static std::vector<ImTextureID> forgetTexture(ImTextureID texture);
+
+    // call func(handle) for every live sprite in the group whose flags, masked, equal want
+    // in handle order, visiting only the group's own sprites. group 0 isn't swept
+    template <typename F>
+    void forEach(int group, uint16_t mask, uint16_t want, F &&func)
+    {
+        auto found = _members.find(group);
+        if (found == _members.end()) return;
+        const std::vector<Handle> &members = found->second;
+        mask |= Live;
+        want |= Live;
+        for (size_t i = 0; i < members.size(); i++)
+        {
+            Handle handle = members[i];
+            if ((flags[handle] & mask) == want)
+            {
+                func(handle);
+            }
+        }
+    }
+
+    // the columns, indexed by handle
+    std::vector<uint16_t> flags;
+    std::vector<int> groups;            // change with setGroup, it keeps the group lists
+    std::vector<Sprite *> owners;
+    std::vector<ImVec2> positions;
+    std::vector<ImVec2> sizes;
+    std::vector<ImVec4> colors;
+    std::vector<ImTextureID> textures;
+    std::vector<std::shared_ptr<const TextureLevels>> levels;  // the texture's, null without any
+    std::vector<float> rotations;
+    std::vector<float> scales;
+    std::vector<int> zOrders;
+
+private:
+    struct Tween
+    {
+        Handle handle;
+        uint16_t kind;          // Moving or Flipping
+        double start;
+        float seconds;
+        ImVec2 from;            // a move's start, a flip's position at rest
+        ImVec2 to;              // a move's end, a flip's size at rest
+        ImTextureID face;       // the face a flip turns to
+        std::shared_ptr<const TextureLevels> faceLevels;
+        Done done;
+    };
+
+    // a texture's levels from the shared registry, null if it has none
+    static std::shared_ptr<const TextureLevels> findLevels(ImTextureID texture);
+    // the level of the texture to draw at the given size
+    static ImTextureID textureForSize(ImTextureID texture, const TextureLevels *levels, const ImVec2 &size);
+
+    // apply a tween at progress 0..1
+    void apply(Tween &tween, float progress);
+    // take a finished tween off the list, queueing its done callback
+    void retireTween(size_t index);
+
+    std::vector<Handle> _free;
+    // each board group's handles, sorted, so painting order doesn't depend on when they joined
+    std::unordered_map<int, std::vector<Handle>> _members;
+    std::vector<Tween> _tweens;
+    std::vector<Done> _finished;
+};
@@ -0,0 +1,139 @@
+#include "ThreadPool.h"
+
+// which worker of which pool the current thread is
+static thread_local ThreadPool *tlsPool = nullptr;
+static thread_local int tlsWorker = -1;
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) : _pending(0), _nextWorker(0), _stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 2;
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    // start the threads only after every deque exists, they steal from each other
+    for (unsigned int i = 0; i < threadCount; i++) {
+        _workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(_sleepLock);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto &worker : _workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+int ThreadPool::currentWorker()
+{
+    return tlsWorker;
+}
+
+bool ThreadPool::onWorker() const
+{
+    return tlsPool == this;
+}
+
+void ThreadPool::enqueue(int worker, Task task)
+{
+    unsigned int index;
+    if (worker >= 0) {
+        index = (unsigned int)worker % size();
+    } else if (tlsPool == this && tlsWorker >= 0) {
+        index = (unsigned int)tlsWorker;
+    } else {
+        index = _nextWorker++ % size();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_workers[index]->lock);
+        _workers[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // taking the sleep lock orders this with a worker about to wait
+        std::lock_guard<std::mutex> guard(_sleepLock);
+        _pending++;
+    }
+    _wake.notify_one();
+}
+
+bool ThreadPool::popTask(unsigned int index, Task &task)
+{
+    Worker &worker = *_workers[index];
+    std::lock_guard<std::mutex> guard(worker.lock);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::stealTask(unsigned int thief, Task &task)
+{
+    unsigned int count = size();
+    for (unsigned int i = 1; i < count; i++) {
+        Worker &victim = *_workers[(thief + i) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask()
+{
+    if (!onWorker()) {
+        return false;
+    }
+    Task task;
+    unsigned int index = (unsigned int)tlsWorker;
+    if (!popTask(index, task) && !stealTask(index, task)) {
+        return false;
+    }
+    _pending--;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned int index)
+{
+    tlsPool = this;
+    tlsWorker = (int)index;
+
+    while (true) {
+        Task task;
+        if (popTask(index, task) || stealTask(index, task)) {
+            _pending--;
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(_sleepLock);
+        _wake.wait(guard, [this]() { return _stopping || _pending > 0; });
+        if (_stopping && _pending <= 0) {
+            return;
+        }
+    }
+}
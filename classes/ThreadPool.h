@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//
+// one process wide work stealing pool for AI searches, analysis and batch jobs
+// each worker owns a deque: it pops its own work from the back and steals from
+// the front of the others when it runs dry. tasks submitted from a worker stay
+// on that worker, and submitTo() pins a task to a specific worker.
+//
+class ThreadPool
+{
+public:
+    // the shared pool, sized to the hardware concurrency
+    static ThreadPool &instance();
+
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int size() const { return (unsigned int)_workers.size(); }
+
+    // index of the pool worker running the caller, or -1 off the pool
+    static int currentWorker();
+
+    template <typename F>
+    auto submit(F &&func) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        return submitTo(-1, std::forward<F>(func));
+    }
+
+    // queue on a given worker (-1 picks the caller's worker, or round robin)
+    template <typename F>
+    auto submitTo(int worker, F &&func) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        typedef std::invoke_result_t<std::decay_t<F>> Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        std::future<Result> result = task->get_future();
+        enqueue(worker, [task]() { (*task)(); });
+        return result;
+    }
+
+    // run one queued task on the calling worker, so a worker blocked on
+    // a future can help instead of idling. returns false if nothing ran.
+    // a thread off the pool never runs the workers' tasks (it could pick up a
+    // long search and stall the frame), so there it always returns false
+    bool runPendingTask();
+
+    // block until the future is ready, a worker runs queued tasks meanwhile
+    template <typename T>
+    T wait(std::future<T> &future)
+    {
+        if (!onWorker()) {
+            return future.get();
+        }
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runPendingTask()) {
+                future.wait_for(std::chrono::microseconds(100));
+            }
+        }
+        return future.get();
+    }
+
+private:
+    typedef std::function<void()> Task;
+
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex lock;
+        std::thread thread;
+    };
+
+    // is the calling thread one of this pool's workers
+    bool onWorker() const;
+
+    void enqueue(int worker, Task task);
+    bool popTask(unsigned int index, Task &task);
+    bool stealTask(unsigned int thief, Task &task);
+    void workerLoop(unsigned int index);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::mutex _sleepLock;
+    std::condition_variable _wake;
+    std::atomic<int> _pending;
+    std::atomic<unsigned int> _nextWorker;
+    std::atomic<bool> _stopping;
+};
@@ -4,10 +4,12 @@
 TicTacToe::TicTacToe()
 {
     _grid = new Grid(3, 3);
+    _lastMoveIndex = -1;
 }
 
 TicTacToe::~TicTacToe()
 {
+    stopPondering();
     delete _grid;
 }
 
@@ -35,6 +37,7 @@ void TicTacToe::setUpBoard()
         setAIPlayer(AI_PLAYER);
     }
 
+    _lastMoveIndex = -1;
     startGame();
 }
 
@@ -48,6 +51,10 @@ bool TicTacToe::actionForEmptyHolder(BitHolder &holder)
     }
     Bit *bit = PieceForPlayer(getCurrentPlayer()->playerNumber() == 0 ? HUMAN_PLAYER : AI_PLAYER);
     if (bit) {
+        ChessSquare *square = static_cast<ChessSquare *>(&holder);
+        _lastMoveIndex = square->getRow() * 3 + square->getColumn();
+        beginMove();
+        recordSquare(_lastMoveIndex);
         bit->setPosition(holder.getPosition());
         holder.setBit(bit);
         endTurn();
@@ -76,6 +83,7 @@ void TicTacToe::stopGame()
     _grid->forEachSquare([](ChessSquare* square, int x, int y) {
         square->destroyBit();
     });
+    forgetLooseBits();
 }
 
 //
@@ -104,6 +112,17 @@ Player* TicTacToe::checkForWinner()
     return nullptr;
 }
 
+//
+// only the lines through the last mark can have been completed
+//
+int TicTacToe::lastMoveResult()
+{
+    if (_lastMoveIndex < 0) {
+        return Game::lastMoveResult();
+    }
+    return _rules.resultAfterMove(stateString(), _lastMoveIndex);
+}
+
 bool TicTacToe::checkForDraw()
 {
     bool isDraw = true;
@@ -146,15 +165,33 @@ std::string TicTacToe::stateString()
 //
 void TicTacToe::setStateString(const std::string &s)
 {
-    _grid->forEachSquare([&](ChessSquare* square, int x, int y) {
-        int index = y*3 + x;
-        int playerNumber = s[index] - '0';
-        if (playerNumber) {
-            square->setBit( PieceForPlayer(playerNumber-1) );
-        } else {
-            square->setBit( nullptr );
+    if (s.length() != 9) return;
+    _lastMoveIndex = -1;
+    clearMoveHistory();
+    std::string current = stateString();
+    for (int index = 0; index < 9; index++) {
+        if (current[index] != s[index]) {
+            setSquareState(index, s[index]);
         }
-    });
+    }
+}
+
+char TicTacToe::squareState(int index)
+{
+    Bit *bit = _grid->getSquareByIndex(index)->bit();
+    return bit ? (char)('1' + bit->getOwner()->playerNumber()) : '0';
+}
+
+void TicTacToe::setSquareState(int index, char state)
+{
+    ChessSquare *square = _grid->getSquareByIndex(index);
+    if (state == '1' || state == '2') {
+        Bit *bit = PieceForPlayer(state == '1' ? HUMAN_PLAYER : AI_PLAYER);
+        bit->setPosition(square->getPosition());
+        square->setBit(bit);
+    } else {
+        square->setBit(nullptr);
+    }
 }
 
 
@@ -244,4 +281,72 @@ int TicTacToe::negamax(std::string& state, int depth, int playerColor)
     }
 
     return bestVal;
-}
\ No newline at end of file
+}
+
+void TicTacToe::applySearchMove(int move)
+{
+    actionForEmptyHolder(*_grid->getSquare(move % 3, move / 3));
+}
+
+//
+// search rules, '1' is player 0 and '2' is player 1
+//
+int TicTacToeRules::currentPlayer(const std::string &state) const
+{
+    return (9 - (int)std::count(state.begin(), state.end(), '0')) & 1;
+}
+
+void TicTacToeRules::generateMoves(const std::string &state, std::vector<int> &moves) const
+{
+    for (int i = 0; i < 9; i++) {
+        if (state[i] == '0') {
+            moves.push_back(i);
+        }
+    }
+}
+
+void TicTacToeRules::playMove(std::string &state, int move) const
+{
+    state[move] = currentPlayer(state) == 0 ? '1' : '2';
+}
+
+int TicTacToeRules::result(const std::string &state) const
+{
+    static const int kWinningTriples[8][3] =  { {0,1,2}, {3,4,5}, {6,7,8},  // rows
+                                                {0,3,6}, {1,4,7}, {2,5,8},  // cols
+                                                {0,4,8}, {2,4,6} };         // diagonals
+    for( int i=0; i<8; i++ ) {
+        const int *triple = kWinningTriples[i];
+        char first = state[triple[0]];
+        if( first != '0' && first == state[triple[1]] && first == state[triple[2]] ) {
+            return first == '1' ? 0 : 1;
+        }
+    }
+    return isAIBoardFull(state) ? Draw : Ongoing;
+}
+
+int TicTacToeRules::resultAfterMove(const std::string &state, int move) const
+{
+    // only the row, the column and maybe a diagonal through the move can be new
+    char piece = state[move];
+    int row = move / 3;
+    int col = move % 3;
+    if (state[row * 3] == piece && state[row * 3 + 1] == piece && state[row * 3 + 2] == piece) {
+        return piece == '1' ? 0 : 1;
+    }
+    if (state[col] == piece && state[col + 3] == piece && state[col + 6] == piece) {
+        return piece == '1' ? 0 : 1;
+    }
+    if (row == col && state[0] == piece && state[4] == piece && state[8] == piece) {
+        return piece == '1' ? 0 : 1;
+    }
+    if (row + col == 2 && state[2] == piece && state[4] == piece && state[6] == piece) {
+        return piece == '1' ? 0 : 1;
+    }
+    return isAIBoardFull(state) ? Draw : Ongoing;
+}
+
+std::string TicTacToeRules::moveName(int move) const
+{
+    return "row " + std::to_string(move / 3 + 1) + ", column " + std::to_string(move % 3 + 1);
+}
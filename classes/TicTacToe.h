@@ -5,6 +5,20 @@
 // the classic game of tic tac toe
 //
 
+//
+// tic-tac-toe rules for MCTS, on the 9 character state string
+//
+class TicTacToeRules : public MCTSRules
+{
+public:
+    int         currentPlayer(const std::string &state) const override;
+    void        generateMoves(const std::string &state, std::vector<int> &moves) const override;
+    void        playMove(std::string &state, int move) const override;
+    int         result(const std::string &state) const override;
+    int         resultAfterMove(const std::string &state, int move) const override;
+    std::string moveName(int move) const override;
+};
+
 //
 // the main game class
 //
@@ -19,6 +33,7 @@ public:
 
     Player*     checkForWinner() override;
     bool        checkForDraw() override;
+    int         lastMoveResult() override;
     std::string initialStateString() override;
     std::string stateString() override;
     void        setStateString(const std::string &s) override;
@@ -28,13 +43,27 @@ public:
     void        stopGame() override;
 
 	void        updateAI() override;
+    // the full negamax is instant, nothing to ponder
+    void        ponder() override {}
     bool        gameHasAI() override { return true; }
     Grid* getGrid() override { return _grid; }
+
+    MCTSRules*  searchRules() override { return &_rules; }
+    void        applySearchMove(int move) override;
+
+protected:
+    char        squareState(int index) override;
+    void        setSquareState(int index, char state) override;
+    int         moveExtra() override { return _lastMoveIndex; }
+    void        setMoveExtra(int extra) override { _lastMoveIndex = extra; }
+
 private:
     Bit *       PieceForPlayer(const int playerNumber);
     Player*     ownerAt(int index ) const;
     int         negamax(std::string& state, int depth, int playerColor);
 
     Grid*       _grid;
+    TicTacToeRules _rules;
+    int         _lastMoveIndex;     // square of the last mark, -1 when unknown
 };
 
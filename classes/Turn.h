@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include "Pooled.h"
 
 class Game;
 class Player;
@@ -11,7 +12,7 @@ typedef enum {
 	kTurnFinished           // Turn is confirmed and finished
 } TurnStatus;
 
-class Turn
+class Turn : public Pooled<Turn>
 {
 public:
 	Turn() : _game(nullptr), _player(nullptr), _status(kTurnEmpty), _move(""), _boardState(""), _date(0), _comment(""), _score(0), _replaying(false), _gameNumber(-1) {};
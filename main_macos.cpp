@@ -17,6 +17,7 @@
 #endif
 #include <GLFW/glfw3.h> // Will drag system OpenGL headers
 #include "Application.h"
+#include "classes/PerfStats.h"
 
 // [Win32] Our example includes a copy of glfw3.lib pre-compiled with VS2010 to maximize ease of testing and compatibility with old VS compilers.
 // To link with VS2010-era libraries, VS2015+ requires linking with legacy_stdio_definitions.lib, which we do using this pragma.
@@ -121,6 +122,8 @@ int main(int, char**)
     bool show_another_window = false;
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
     ClassGame::GameStartUp();
+    ClassGame::SetWakeUp(glfwPostEmptyEvent);
+    int settleFrames = 0;
     
     // Main loop
 #ifdef __EMSCRIPTEN__
@@ -137,7 +140,24 @@ int main(int, char**)
         // - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
         // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
         // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
+#ifndef __EMSCRIPTEN__
+        // with nothing moving and nobody thinking, block until input or a wakeup arrives
+        // a few frames still run after each event so ImGui can settle hover and focus
+        double idleWait = ClassGame::IdleWaitTime();
+        if (idleWait > 0.0 && settleFrames >= 3)
+        {
+            PerfStats::Scope waiting(PerfStats::Idle);
+            glfwWaitEventsTimeout(idleWait);
+            settleFrames = 0;
+        }
+        else
+        {
+            glfwPollEvents();
+            settleFrames = idleWait > 0.0 ? settleFrames + 1 : 0;
+        }
+#else
         glfwPollEvents();
+#endif
 
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -173,6 +193,7 @@ int main(int, char**)
 #endif
 
     // Cleanup
+    ClassGame::GameShutDown();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
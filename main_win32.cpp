@@ -12,6 +12,7 @@
 #include <d3d11.h>
 #include <tchar.h>
 #include "Application.h"
+#include "classes/PerfStats.h"
 
 // Data
 ID3D11Device*            g_pd3dDevice = nullptr;
@@ -20,6 +21,7 @@ static IDXGISwapChain*          g_pSwapChain = nullptr;
 static bool                     g_SwapChainOccluded = false;
 static UINT                     g_ResizeWidth = 0, g_ResizeHeight = 0;
 static ID3D11RenderTargetView*  g_mainRenderTargetView = nullptr;
+static DWORD                    g_MainThreadId = 0;
 
 // Forward declarations of helper functions
 bool CreateDeviceD3D(HWND hWnd);
@@ -28,6 +30,12 @@ void CreateRenderTarget();
 void CleanupRenderTarget();
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+// an empty message is enough to end the idle wait in the main loop
+static void WakeMainLoop()
+{
+    ::PostThreadMessage(g_MainThreadId, WM_NULL, 0, 0);
+}
+
 // Main code
 int main(int, char**)
 {
@@ -107,11 +115,28 @@ int main(int, char**)
 
     // Our state
     ClassGame::GameStartUp();
+    g_MainThreadId = ::GetCurrentThreadId();
+    ClassGame::SetWakeUp(WakeMainLoop);
+    int settleFrames = 0;
 
     // Main loop
     bool done = false;
     while (!done)
     {
+        // with nothing moving and nobody thinking, block until input or a wakeup arrives
+        // a few frames still run after each event so ImGui can settle hover and focus
+        double idleWait = ClassGame::IdleWaitTime();
+        if (idleWait > 0.0 && settleFrames >= 3)
+        {
+            PerfStats::Scope waiting(PerfStats::Idle);
+            ::MsgWaitForMultipleObjects(0, nullptr, FALSE, (DWORD)(idleWait * 1000.0), QS_ALLINPUT);
+            settleFrames = 0;
+        }
+        else
+        {
+            settleFrames = idleWait > 0.0 ? settleFrames + 1 : 0;
+        }
+
         // Poll and handle messages (inputs, window resize, etc.)
         // See the WndProc() function below for our to dispatch events to the Win32 backend.
         MSG msg;
@@ -169,6 +194,7 @@ int main(int, char**)
     }
 
     // Cleanup
+    ClassGame::GameShutDown();
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,122 @@
+//
+// small GraphPuzzle levels with known answers: breadth first search and A*
+// must agree on the optimal move count, and both must give up on a level
+// whose exit can't be reached
+//
+#include "../classes/GraphPuzzle.h"
+#include "../classes/PuzzleSolver.h"
+
+#include <cstdio>
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// every orthogonal neighbour connected both ways
+static void connectAll(Grid &grid)
+{
+    for (int y = 0; y < grid.getHeight(); y++) {
+        for (int x = 0; x < grid.getWidth(); x++) {
+            if (x + 1 < grid.getWidth()) {
+                grid.addConnection(x, y, x + 1, y);
+                grid.addConnection(x + 1, y, x, y);
+            }
+            if (y + 1 < grid.getHeight()) {
+                grid.addConnection(x, y, x, y + 1);
+                grid.addConnection(x, y + 1, x, y);
+            }
+        }
+    }
+}
+
+// the moves must be legal one after the other and end on the exit
+static bool replays(const GraphPuzzle &puzzle, const std::vector<int> &moves)
+{
+    uint64_t state = puzzle.initialState();
+    std::vector<std::pair<int, uint64_t>> next;
+    for (int move : moves) {
+        next.clear();
+        puzzle.successors(state, next);
+        bool found = false;
+        for (const auto &successor : next) {
+            if (successor.first == move) {
+                state = successor.second;
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+    }
+    return puzzle.isGoal(state);
+}
+
+static void solvable(const char *name, GraphPuzzle &puzzle, int expectedMoves)
+{
+    std::printf("%s\n", name);
+    check(puzzle.prepare(), "level prepares");
+    PuzzleSolver bfsSolver(puzzle);
+    PuzzleSolver::Solution bfs = bfsSolver.solveBFS();
+    PuzzleSolver aStarSolver(puzzle);
+    PuzzleSolver::Solution aStar = aStarSolver.solveAStar();
+    check(bfs.solved && aStar.solved, "both searches solve it");
+    check(bfs.moves.size() == aStar.moves.size(), "BFS and A* find the same move count");
+    if (expectedMoves >= 0) {
+        check((int)bfs.moves.size() == expectedMoves, "the known optimal move count");
+    }
+    check(replays(puzzle, bfs.moves), "the BFS solution replays to the exit");
+    check(replays(puzzle, aStar.moves), "the A* solution replays to the exit");
+}
+
+int main()
+{
+    // a straight corridor, three steps to the exit
+    Grid corridor(4, 1);
+    connectAll(corridor);
+    GraphPuzzle walk(corridor);
+    walk.setPlayer(corridor.getIndex(0, 0));
+    walk.setExit(corridor.getIndex(3, 0));
+    solvable("corridor", walk, 3);
+
+    // a patrol pacing the middle row of a 3x3 board has to be dodged or taken
+    Grid open(3, 3);
+    connectAll(open);
+    GraphPuzzle patrol(open);
+    patrol.setPlayer(open.getIndex(0, 0));
+    patrol.setExit(open.getIndex(2, 2));
+    patrol.addPatrol({open.getIndex(0, 1), open.getIndex(1, 1), open.getIndex(2, 1)});
+    solvable("patrol", patrol, -1);
+
+    // the exit has no way in
+    std::printf("walled off\n");
+    Grid walled(3, 3);
+    for (int x = 0; x < 3; x++) {
+        for (int y = 0; y < 3; y++) {
+            if (x + 1 < 3 && !(x + 1 == 2 && y == 2)) {
+                walled.addConnection(x, y, x + 1, y);
+                walled.addConnection(x + 1, y, x, y);
+            }
+            if (y + 1 < 3 && !(x == 2 && y + 1 == 2)) {
+                walled.addConnection(x, y, x, y + 1);
+                walled.addConnection(x, y + 1, x, y);
+            }
+        }
+    }
+    walled.addConnection(2, 2, 1, 2);
+    GraphPuzzle blocked(walled);
+    blocked.setPlayer(walled.getIndex(0, 0));
+    blocked.setExit(walled.getIndex(2, 2));
+    check(blocked.prepare(), "level prepares");
+    PuzzleSolver bfsSolver(blocked);
+    PuzzleSolver aStarSolver(blocked);
+    check(!bfsSolver.solveBFS().solved, "BFS finds no solution");
+    check(!aStarSolver.solveAStar().solved, "A* finds no solution");
+
+    std::printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
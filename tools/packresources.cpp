@@ -0,0 +1,105 @@
+//
+// build step: decode every PNG in a resources directory to RGBA and write them
+// all to one pack file the game maps at startup (see classes/ResourcePack.h)
+//
+// usage: packresources <resources dir> <output pack>
+//
+#define STB_IMAGE_IMPLEMENTATION
+#include "../classes/stb_image.h"
+#include "../classes/ResourcePack.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+struct Image
+{
+    std::string name;
+    int width;
+    int height;
+    unsigned char *pixels;
+};
+
+// pixel blocks start on a 16 byte boundary so an upload can read them directly
+static uint64_t aligned(uint64_t offset)
+{
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        std::cerr << "usage: packresources <resources dir> <output pack>" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::filesystem::path> files;
+    for (const auto &item : std::filesystem::directory_iterator(argv[1])) {
+        if (item.is_regular_file() && item.path().extension() == ".png") {
+            files.push_back(item.path());
+        }
+    }
+    // sorted, so the same resources always make the same pack
+    std::sort(files.begin(), files.end());
+
+    std::vector<Image> images;
+    for (const auto &file : files) {
+        std::string name = file.filename().string();
+        if (name.size() >= ResourcePack::NameLength) {
+            std::cerr << "packresources: name too long, left out: " << name << std::endl;
+            continue;
+        }
+        Image image{name, 0, 0, nullptr};
+        image.pixels = stbi_load(file.string().c_str(), &image.width, &image.height, NULL, 4);
+        if (!image.pixels) {
+            std::cerr << "packresources: can't decode " << file.string() << std::endl;
+            return 1;
+        }
+        images.push_back(image);
+    }
+
+    ResourcePack::Header header;
+    std::memcpy(header.magic, "CGPK", 4);
+    header.version = ResourcePack::Version;
+    header.count = (uint32_t)images.size();
+    header.reserved = 0;
+
+    std::vector<ResourcePack::Entry> entries(images.size());
+    uint64_t offset = aligned(sizeof(header) + entries.size() * sizeof(ResourcePack::Entry));
+    for (size_t i = 0; i < images.size(); i++) {
+        ResourcePack::Entry &entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, images[i].name.c_str(), images[i].name.size());
+        entry.width = (uint32_t)images[i].width;
+        entry.height = (uint32_t)images[i].height;
+        entry.offset = offset;
+        offset = aligned(offset + (uint64_t)entry.width * entry.height * 4);
+    }
+
+    // write to the side and rename, so a running game never maps a half written pack
+    std::filesystem::path output(argv[2]);
+    std::filesystem::path partial = output;
+    partial += ".partial";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(ResourcePack::Entry));
+        for (size_t i = 0; i < images.size(); i++) {
+            static const char padding[16] = {};
+            out.write(padding, (std::streamsize)(entries[i].offset - (uint64_t)out.tellp()));
+            out.write(reinterpret_cast<const char *>(images[i].pixels), (std::streamsize)entries[i].width * entries[i].height * 4);
+            stbi_image_free(images[i].pixels);
+        }
+        if (!out) {
+            std::cerr << "packresources: can't write " << partial.string() << std::endl;
+            return 1;
+        }
+    }
+    std::filesystem::rename(partial, output);
+    std::cout << "packed " << images.size() << " images into " << output.string() << std::endl;
+    return 0;
+}